@@ -22,10 +22,28 @@
 #include <linux/power/max17042_battery.h>
 #include <linux/of.h>
 #include <linux/regmap.h>
+#include <linux/math64.h>
+#include <linux/unaligned.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include <linux/crc16.h>
+#include <linux/nvmem-consumer.h>
+#include <linux/hwmon.h>
+
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
+
+#define CREATE_TRACE_POINTS
+#include "max17042_battery_trace.h"
 
 /* Status register bits */
 #define STATUS_POR_BIT         (1 << 1)
 #define STATUS_BST_BIT         (1 << 3)
+#define STATUS_DSOCI_BIT       (1 << 7)
 #define STATUS_VMN_BIT         (1 << 8)
 #define STATUS_TMN_BIT         (1 << 9)
 #define STATUS_SMN_BIT         (1 << 10)
@@ -37,6 +55,7 @@
 
 /* Interrupt mask bits */
 #define CONFIG_ALRT_BIT_ENBL	(1 << 2)
+#define CONFIG2_DSOCEN_BIT	(1 << 7)	/* MAX17055 only */
 
 #define VFSOC0_LOCK		0x0000
 #define VFSOC0_UNLOCK		0x0080
@@ -45,59 +64,331 @@
 #define MODEL_LOCK1		0X0000
 #define MODEL_LOCK2		0X0000
 
+/* MAX17055 EZ configuration */
+#define FSTAT_DNR_BIT		(1 << 0)
+#define MODELCFG_REFRESH_BIT	(1 << 15)
+#define MODELCFG_VCHG_BIT	(1 << 10)
+#define HIBCFG_DISABLE		0x0000
+#define CMD_SOFT_WAKEUP		0x0090
+#define CMD_CLEAR		0x0000
+#define VEMPTY_VE_SHIFT		7
+#define VEMPTY_VR_DEFAULT	0x61	/* 3.88V recovery, 40mV units */
+#define MAX17055_VCHG_THRESHOLD	4275000	/* uV, above this set VChg */
+#define MAX17055_POLL_US	10000
+#define MAX17055_DNR_TIMEOUT_US	1000000
+#define MAX17055_REFRESH_TIMEOUT_US	1000000
+
 #define dQ_ACC_DIV	0x4
 #define dP_ACC_100	0x1900
 #define dP_ACC_200	0x3200
 
 #define MAX17042_VMAX_TOLERANCE		50 /* 50 mV */
 
+/* Cached register windows, see max17042_snapshot_refresh() */
+#define MAX17042_SNAP_LO_REGS		0x21	/* STATUS .. TTF */
+#define MAX17042_SNAP_VF_REGS		5	/* OCVInternal .. VFSOC */
+#define MAX17042_SNAP_PWR_REGS		4	/* MAX17055 Status2 .. AvgPower */
+#define MAX17042_SNAP_PEAK_REGS		2	/* MaxPeakPwr, SusPeakPwr */
+
+#define MAX17042_LEARNED_MAGIC		0x4c47	/* "GL" */
+#define MAX17042_LEARNED_VERSION	1
+
+/* Bus latency histogram: <32us, <64us, ... <2ms, >=2ms */
+#define MAX17042_LAT_BUCKETS		8
+#define MAX17042_LAT_MIN_SHIFT		5
+
+/*
+ * POR override: register and the offset of the u16 max17042_config_data
+ * member holding its value. Written only when the value is non-zero.
+ */
+struct max17042_por_reg {
+	u8 reg;
+	u16 offset;
+};
+
+/* Per-variant description, selected once at probe time */
+struct max17042_chip_info {
+	u8 vempty_reg;
+	bool has_full_soc_thr;	/* FullSOCThr at 0x13 */
+	bool has_qrtbl;		/* QRTbl00..30 instead of EmptyTempCo/K_empty0 */
+	bool has_power;		/* Power/AvgPower and peak power registers */
+	bool has_dsoc_alert;	/* Config2.dSOCen */
+	bool has_ez_config;	/* ModelGauge m5 EZ init from battery info */
+	const struct max17042_por_reg *por_regs;
+	int num_por_regs;
+	const struct max17042_reg_data *default_init_regs;
+	int num_default_init_regs;
+	const struct power_supply_desc *psy_desc;
+	const struct power_supply_desc *psy_desc_no_current_sense;
+};
+
+/*
+ * Bus accounting, updated from the regmap bus callbacks (serialized by the
+ * regmap lock) and from the IRQ thread.
+ */
+struct max17042_bus_stats {
+	u32 reads[256];		/* registers read, by address */
+	u32 writes[256];	/* registers written, by address */
+	u64 xfers;
+	u64 busy_ns;
+	u64 max_ns;
+	u32 lat_hist[MAX17042_LAT_BUCKETS];
+	u32 irqs;
+	u32 irq_status[16];	/* alerts seen, by STATUS bit */
+	u32 notify_sent;	/* power_supply_changed calls */
+	u32 notify_suppressed;	/* dropped, below every delta */
+	u32 notify_deferred;	/* postponed by the minimum interval */
+};
+
+/*
+ * Learned gauge state, as exported through the learned_params sysfs blob
+ * and the optional "learned-params" nvmem cell. Little endian, crc is the
+ * CRC16 of all preceding bytes.
+ */
+struct max17042_learned {
+	__le16 magic;
+	u8 version;
+	u8 chip_type;
+	__le16 rcomp0;
+	__le16 tempco;
+	__le16 fullcap;
+	__le16 fullcapnom;
+	__le16 cycles;
+	__le16 qh;
+	__le16 crc;
+} __packed;
+
+/*
+ * Copy of the registers served by get_property, refreshed in one pass by
+ * the alert IRQ or the snapshot work and read under chip->snap_lock.
+ */
+struct max17042_snapshot {
+	u16 regs[MAX17042_SNAP_LO_REGS];
+	u16 vf[MAX17042_SNAP_VF_REGS];
+	u16 pwr[MAX17042_SNAP_PWR_REGS];
+	u16 peak[MAX17042_SNAP_PEAK_REGS];
+	u16 qh;
+	u16 vempty;
+	bool valid;
+};
+
+/* MAX17055 EZ register values, derived from simple-battery at probe time */
+struct max17055_ez_config {
+	u16 design_cap;
+	u16 dqacc;
+	u16 dpacc;
+	u16 ichg_term;
+	u16 vempty;
+	u16 model_cfg;
+};
+
 struct max17042_chip {
 	struct i2c_client *client;
 	struct regmap *regmap;
 	struct power_supply *battery;
 	enum max170xx_chip_type chip_type;
+	const struct max17042_chip_info *info;
 	struct max17042_platform_data *pdata;
+	/* Q32.32 unit factors derived from r_sns at probe time */
+	u64 charge_scale;	/* uAh per capacity LSB */
+	u64 current_scale;	/* uA per current LSB */
+	u64 power_scale;	/* uW per power LSB */
+	u8 soc_reg;		/* RepSOC, or VFSOC without current sense */
+	struct max17055_ez_config ez;	/* valid when design_cap is set */
+	/* POR overrides built from simple-battery when there is no pdata one */
+	struct max17042_config_data *batt_config;
 	struct work_struct work;
+	struct delayed_work notify_work;
+	struct mutex notify_lock;	/* protects the notify_* state below */
+	unsigned long notify_last;	/* jiffies of the last notification */
+	int    notify_soc;	/* values at the last notification */
+	int    notify_mv;
+	int    notify_ma;
+	bool   notify_force;	/* a queued notification must not be dropped */
+	struct delayed_work snap_work;
+	seqlock_t snap_lock;
+	struct max17042_snapshot snap;
 	int    init_complete;
+	bool   dsoc_alert;	/* SOC alerts come from Config2.dSOCen */
+	u32    i2c_func;	/* adapter functionality, picks the bus path */
+	struct max17042_bus_stats stats;
+	struct nvmem_cell *learned_cell;
+	struct mutex learned_lock;	/* protects learned, have_learned */
+	struct max17042_learned learned;
+	bool   have_learned;
 };
 
+#define MAX17042_COMMON_PROPS						\
+	POWER_SUPPLY_PROP_STATUS,					\
+	POWER_SUPPLY_PROP_PRESENT,					\
+	POWER_SUPPLY_PROP_TECHNOLOGY,					\
+	POWER_SUPPLY_PROP_CYCLE_COUNT,					\
+	POWER_SUPPLY_PROP_VOLTAGE_MAX,					\
+	POWER_SUPPLY_PROP_VOLTAGE_MIN,					\
+	POWER_SUPPLY_PROP_VOLTAGE_MIN_DESIGN,				\
+	POWER_SUPPLY_PROP_VOLTAGE_NOW,					\
+	POWER_SUPPLY_PROP_VOLTAGE_AVG,					\
+	POWER_SUPPLY_PROP_VOLTAGE_OCV,					\
+	POWER_SUPPLY_PROP_CAPACITY,					\
+	POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN,				\
+	POWER_SUPPLY_PROP_CHARGE_FULL,					\
+	POWER_SUPPLY_PROP_CHARGE_NOW,					\
+	POWER_SUPPLY_PROP_CHARGE_COUNTER,				\
+	POWER_SUPPLY_PROP_CHARGE_TERM_CURRENT,				\
+	POWER_SUPPLY_PROP_TEMP,						\
+	POWER_SUPPLY_PROP_TEMP_ALERT_MIN,				\
+	POWER_SUPPLY_PROP_TEMP_ALERT_MAX,				\
+	POWER_SUPPLY_PROP_TEMP_MIN,					\
+	POWER_SUPPLY_PROP_TEMP_MAX,					\
+	POWER_SUPPLY_PROP_HEALTH,					\
+	POWER_SUPPLY_PROP_SCOPE,					\
+	POWER_SUPPLY_PROP_TIME_TO_EMPTY_NOW
+
 static enum power_supply_property max17042_battery_props[] = {
-	POWER_SUPPLY_PROP_STATUS,
-	POWER_SUPPLY_PROP_PRESENT,
-	POWER_SUPPLY_PROP_TECHNOLOGY,
-	POWER_SUPPLY_PROP_CYCLE_COUNT,
-	POWER_SUPPLY_PROP_VOLTAGE_MAX,
-	POWER_SUPPLY_PROP_VOLTAGE_MIN,
-	POWER_SUPPLY_PROP_VOLTAGE_MIN_DESIGN,
-	POWER_SUPPLY_PROP_VOLTAGE_NOW,
-	POWER_SUPPLY_PROP_VOLTAGE_AVG,
-	POWER_SUPPLY_PROP_VOLTAGE_OCV,
-	POWER_SUPPLY_PROP_CAPACITY,
-	POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN,
-	POWER_SUPPLY_PROP_CHARGE_FULL,
-	POWER_SUPPLY_PROP_CHARGE_NOW,
-	POWER_SUPPLY_PROP_CHARGE_COUNTER,
-	POWER_SUPPLY_PROP_CHARGE_TERM_CURRENT,
-	POWER_SUPPLY_PROP_TEMP,
-	POWER_SUPPLY_PROP_TEMP_ALERT_MIN,
-	POWER_SUPPLY_PROP_TEMP_ALERT_MAX,
-	POWER_SUPPLY_PROP_TEMP_MIN,
-	POWER_SUPPLY_PROP_TEMP_MAX,
-	POWER_SUPPLY_PROP_HEALTH,
-	POWER_SUPPLY_PROP_SCOPE,
-	POWER_SUPPLY_PROP_TIME_TO_EMPTY_NOW,
+	MAX17042_COMMON_PROPS,
 	// these two have to be at the end on the list
 	POWER_SUPPLY_PROP_CURRENT_NOW,
 	POWER_SUPPLY_PROP_CURRENT_AVG,
 };
 
+static enum power_supply_property max17055_battery_props[] = {
+	MAX17042_COMMON_PROPS,
+	// these five need current sense and have to be at the end on the list
+	POWER_SUPPLY_PROP_TIME_TO_FULL_NOW,
+	POWER_SUPPLY_PROP_POWER_NOW,
+	POWER_SUPPLY_PROP_POWER_AVG,
+	POWER_SUPPLY_PROP_CURRENT_NOW,
+	POWER_SUPPLY_PROP_CURRENT_AVG,
+};
+
+/* Apply a unit factor precomputed by max17042_init_scales() */
+static inline int max17042_scale(u64 factor, s32 raw)
+{
+	u64 v = mul_u64_u32_shr(factor, abs(raw), 32);
+
+	return raw < 0 ? -(int)v : (int)v;
+}
+
+static void max17042_init_scales(struct max17042_chip *chip)
+{
+	u32 r_sns = chip->pdata->r_sns;
+
+	/* Capacity LSB = 5 uVh / r_sns, current LSB = 1.5625 uV / r_sns */
+	chip->charge_scale = div_u64((5000000ULL << 32) + r_sns / 2, r_sns);
+	chip->current_scale = div_u64((1562500ULL << 32) + r_sns / 2, r_sns);
+	/* Power LSB = 0.8 mW with a 10 mOhm r_sns */
+	chip->power_scale = div_u64((8000000ULL << 32) + r_sns / 2, r_sns);
+
+	if (chip->pdata->enable_current_sense)
+		chip->soc_reg = MAX17042_RepSOC;
+	else
+		chip->soc_reg = MAX17042_VFSOC;
+}
+
+static int max17042_snapshot_refresh(struct max17042_chip *chip)
+{
+	struct max17042_snapshot snap = { .valid = true };
+	struct regmap *map = chip->regmap;
+	u32 qh, vempty;
+	int ret;
+
+	ret = regmap_bulk_read(map, MAX17042_STATUS, snap.regs,
+			       ARRAY_SIZE(snap.regs));
+	if (!ret)
+		ret = regmap_bulk_read(map, MAX17042_OCVInternal, snap.vf,
+				       ARRAY_SIZE(snap.vf));
+	if (!ret && chip->info->has_power)
+		ret = regmap_bulk_read(map, MAX17055_STATUS2, snap.pwr,
+				       ARRAY_SIZE(snap.pwr));
+	if (!ret && chip->info->has_power)
+		ret = regmap_bulk_read(map, MAX17055_MaxPeakPwr, snap.peak,
+				       ARRAY_SIZE(snap.peak));
+	if (!ret)
+		ret = regmap_read(map, MAX17042_QH, &qh);
+	if (!ret)
+		ret = regmap_read(map, chip->info->vempty_reg, &vempty);
+	if (ret < 0)
+		return ret;
+
+	snap.qh = qh;
+	snap.vempty = vempty;
+
+	write_seqlock(&chip->snap_lock);
+	chip->snap = snap;
+	write_sequnlock(&chip->snap_lock);
+
+	return 0;
+}
+
+static bool max17042_snapshot_lookup(struct max17042_chip *chip, u8 reg,
+				     u32 *val)
+{
+	const struct max17042_snapshot *snap = &chip->snap;
+
+	if (!snap->valid)
+		return false;
+
+	if (reg == chip->info->vempty_reg)
+		*val = snap->vempty;
+	else if (reg < MAX17042_SNAP_LO_REGS)
+		*val = snap->regs[reg];
+	else if (reg >= MAX17042_OCVInternal)
+		*val = snap->vf[reg - MAX17042_OCVInternal];
+	else if (reg == MAX17042_QH)
+		*val = snap->qh;
+	else if (chip->info->has_power && reg >= MAX17055_STATUS2 &&
+		 reg < MAX17055_STATUS2 + MAX17042_SNAP_PWR_REGS)
+		*val = snap->pwr[reg - MAX17055_STATUS2];
+	else if (chip->info->has_power && reg >= MAX17055_MaxPeakPwr &&
+		 reg < MAX17055_MaxPeakPwr + MAX17042_SNAP_PEAK_REGS)
+		*val = snap->peak[reg - MAX17055_MaxPeakPwr];
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * Serve a register from the snapshot when caching is enabled, so that
+ * concurrent readers neither touch the bus nor serialize on it.
+ */
+static int max17042_read_cached(struct max17042_chip *chip, u8 reg, u32 *val)
+{
+	unsigned int seq;
+	bool hit;
+
+	if (chip->pdata->snapshot_interval_ms) {
+		do {
+			seq = read_seqbegin(&chip->snap_lock);
+			hit = max17042_snapshot_lookup(chip, reg, val);
+		} while (read_seqretry(&chip->snap_lock, seq));
+
+		if (hit)
+			return 0;
+	}
+
+	return regmap_read(chip->regmap, reg, val);
+}
+
+static void max17042_snapshot_worker(struct work_struct *work)
+{
+	struct max17042_chip *chip = container_of(work, struct max17042_chip,
+						  snap_work.work);
+
+	if (chip->init_complete)
+		max17042_snapshot_refresh(chip);
+
+	queue_delayed_work(system_freezable_power_efficient_wq,
+			   &chip->snap_work,
+			   msecs_to_jiffies(chip->pdata->snapshot_interval_ms));
+}
+
 static int max17042_get_temperature(struct max17042_chip *chip, int *temp)
 {
 	int ret;
 	u32 data;
-	struct regmap *map = chip->regmap;
 
-	ret = regmap_read(map, MAX17042_TEMP, &data);
+	ret = max17042_read_cached(chip, MAX17042_TEMP, &data);
 	if (ret < 0)
 		return ret;
 
@@ -134,11 +425,11 @@ static int max17042_get_status(struct max17042_chip *chip, int *status)
 	 * 2 to differ a bit.
 	 */
 
-	ret = regmap_read(chip->regmap, MAX17042_FullCAP, &charge_full);
+	ret = max17042_read_cached(chip, MAX17042_FullCAP, &charge_full);
 	if (ret < 0)
 		return ret;
 
-	ret = regmap_read(chip->regmap, MAX17042_RepCap, &charge_now);
+	ret = max17042_read_cached(chip, MAX17042_RepCap, &charge_now);
 	if (ret < 0)
 		return ret;
 
@@ -156,12 +447,12 @@ static int max17042_get_status(struct max17042_chip *chip, int *status)
 		return 0;
 	}
 
-	ret = regmap_read(chip->regmap, MAX17042_AvgCurrent, &data);
+	ret = max17042_read_cached(chip, MAX17042_AvgCurrent, &data);
 	if (ret < 0)
 		return ret;
 
-	avg_current = sign_extend32(data, 15);
-	avg_current *= 1562500 / chip->pdata->r_sns;
+	avg_current = max17042_scale(chip->current_scale,
+				     sign_extend32(data, 15));
 
 	if (avg_current > 0)
 		*status = POWER_SUPPLY_STATUS_CHARGING;
@@ -176,7 +467,7 @@ static int max17042_get_battery_health(struct max17042_chip *chip, int *health)
 	int temp, vavg, vbatt, ret;
 	u32 val;
 
-	ret = regmap_read(chip->regmap, MAX17042_AvgVCELL, &val);
+	ret = max17042_read_cached(chip, MAX17042_AvgVCELL, &val);
 	if (ret < 0)
 		goto health_error;
 
@@ -185,7 +476,7 @@ static int max17042_get_battery_health(struct max17042_chip *chip, int *health)
 	/* Convert to millivolts */
 	vavg /= 1000;
 
-	ret = regmap_read(chip->regmap, MAX17042_VCELL, &val);
+	ret = max17042_read_cached(chip, MAX17042_VCELL, &val);
 	if (ret < 0)
 		goto health_error;
 
@@ -227,15 +518,12 @@ health_error:
 	return ret;
 }
 
-static int max17042_get_property(struct power_supply *psy,
+static int __max17042_get_property(struct max17042_chip *chip,
 			    enum power_supply_property psp,
 			    union power_supply_propval *val)
 {
-	struct max17042_chip *chip = power_supply_get_drvdata(psy);
-	struct regmap *map = chip->regmap;
 	int ret;
 	u32 data;
-	u64 data64;
 
 	if (!chip->init_complete)
 		return -EAGAIN;
@@ -247,7 +535,7 @@ static int max17042_get_property(struct power_supply *psy,
 			return ret;
 		break;
 	case POWER_SUPPLY_PROP_PRESENT:
-		ret = regmap_read(map, MAX17042_STATUS, &data);
+		ret = max17042_read_cached(chip, MAX17042_STATUS, &data);
 		if (ret < 0)
 			return ret;
 
@@ -260,14 +548,14 @@ static int max17042_get_property(struct power_supply *psy,
 		val->intval = POWER_SUPPLY_TECHNOLOGY_LION;
 		break;
 	case POWER_SUPPLY_PROP_CYCLE_COUNT:
-		ret = regmap_read(map, MAX17042_Cycles, &data);
+		ret = max17042_read_cached(chip, MAX17042_Cycles, &data);
 		if (ret < 0)
 			return ret;
 
 		val->intval = data;
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_MAX:
-		ret = regmap_read(map, MAX17042_MinMaxVolt, &data);
+		ret = max17042_read_cached(chip, MAX17042_MinMaxVolt, &data);
 		if (ret < 0)
 			return ret;
 
@@ -275,17 +563,14 @@ static int max17042_get_property(struct power_supply *psy,
 		val->intval *= 20000; /* Units of LSB = 20mV */
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_MIN:
-		ret = regmap_read(map, MAX17042_MinMaxVolt, &data);
+		ret = max17042_read_cached(chip, MAX17042_MinMaxVolt, &data);
 		if (ret < 0)
 			return ret;
 
 		val->intval = (data & 0xff) * 20000; /* Units of 20mV */
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_MIN_DESIGN:
-		if (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17042)
-			ret = regmap_read(map, MAX17042_V_empty, &data);
-		else
-			ret = regmap_read(map, MAX17047_V_empty, &data);
+		ret = max17042_read_cached(chip, chip->info->vempty_reg, &data);
 		if (ret < 0)
 			return ret;
 
@@ -293,70 +578,61 @@ static int max17042_get_property(struct power_supply *psy,
 		val->intval *= 10000; /* Units of LSB = 10mV */
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
-		ret = regmap_read(map, MAX17042_VCELL, &data);
+		ret = max17042_read_cached(chip, MAX17042_VCELL, &data);
 		if (ret < 0)
 			return ret;
 
 		val->intval = data * 625 / 8;
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_AVG:
-		ret = regmap_read(map, MAX17042_AvgVCELL, &data);
+		ret = max17042_read_cached(chip, MAX17042_AvgVCELL, &data);
 		if (ret < 0)
 			return ret;
 
 		val->intval = data * 625 / 8;
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_OCV:
-		ret = regmap_read(map, MAX17042_OCVInternal, &data);
+		ret = max17042_read_cached(chip, MAX17042_OCVInternal, &data);
 		if (ret < 0)
 			return ret;
 
 		val->intval = data * 625 / 8;
 		break;
 	case POWER_SUPPLY_PROP_CAPACITY:
-		if (chip->pdata->enable_current_sense)
-			ret = regmap_read(map, MAX17042_RepSOC, &data);
-		else
-			ret = regmap_read(map, MAX17042_VFSOC, &data);
+		ret = max17042_read_cached(chip, chip->soc_reg, &data);
 		if (ret < 0)
 			return ret;
 
 		val->intval = data >> 8;
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN:
-		ret = regmap_read(map, MAX17042_DesignCap, &data);
+		ret = max17042_read_cached(chip, MAX17042_DesignCap, &data);
 		if (ret < 0)
 			return ret;
 
-		data64 = data * 5000000ll;
-		do_div(data64, chip->pdata->r_sns);
-		val->intval = data64;
+		val->intval = max17042_scale(chip->charge_scale, data);
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_FULL:
-		ret = regmap_read(map, MAX17042_FullCAP, &data);
+		ret = max17042_read_cached(chip, MAX17042_FullCAP, &data);
 		if (ret < 0)
 			return ret;
 
-		data64 = data * 5000000ll;
-		do_div(data64, chip->pdata->r_sns);
-		val->intval = data64;
+		val->intval = max17042_scale(chip->charge_scale, data);
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_NOW:
-		ret = regmap_read(map, MAX17042_RepCap, &data);
+		ret = max17042_read_cached(chip, MAX17042_RepCap, &data);
 		if (ret < 0)
 			return ret;
 
-		data64 = data * 5000000ll;
-		do_div(data64, chip->pdata->r_sns);
-		val->intval = data64;
+		val->intval = max17042_scale(chip->charge_scale, data);
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_COUNTER:
-		ret = regmap_read(map, MAX17042_QH, &data);
+		ret = max17042_read_cached(chip, MAX17042_QH, &data);
 		if (ret < 0)
 			return ret;
 
-		data64 = sign_extend64(data, 15) * 5000000ll;
-		val->intval = div_s64(data64, chip->pdata->r_sns);
+		val->intval = max17042_scale(chip->charge_scale,
+					     sign_extend32(data, 15));
 		break;
 	case POWER_SUPPLY_PROP_TEMP:
 		ret = max17042_get_temperature(chip, &val->intval);
@@ -364,14 +640,14 @@ static int max17042_get_property(struct power_supply *psy,
 			return ret;
 		break;
 	case POWER_SUPPLY_PROP_TEMP_ALERT_MIN:
-		ret = regmap_read(map, MAX17042_TALRT_Th, &data);
+		ret = max17042_read_cached(chip, MAX17042_TALRT_Th, &data);
 		if (ret < 0)
 			return ret;
 		/* LSB is Alert Minimum. In deci-centigrade */
 		val->intval = sign_extend32(data & 0xff, 7) * 10;
 		break;
 	case POWER_SUPPLY_PROP_TEMP_ALERT_MAX:
-		ret = regmap_read(map, MAX17042_TALRT_Th, &data);
+		ret = max17042_read_cached(chip, MAX17042_TALRT_Th, &data);
 		if (ret < 0)
 			return ret;
 		/* MSB is Alert Maximum. In deci-centigrade */
@@ -393,49 +669,88 @@ static int max17042_get_property(struct power_supply *psy,
 		break;
 	case POWER_SUPPLY_PROP_CURRENT_NOW:
 		if (chip->pdata->enable_current_sense) {
-			ret = regmap_read(map, MAX17042_Current, &data);
+			ret = max17042_read_cached(chip, MAX17042_Current, &data);
 			if (ret < 0)
 				return ret;
 
-			data64 = sign_extend64(data, 15) * 1562500ll;
-			val->intval = div_s64(data64, chip->pdata->r_sns);
+			val->intval = max17042_scale(chip->current_scale,
+						     sign_extend32(data, 15));
 		} else {
 			return -EINVAL;
 		}
 		break;
 	case POWER_SUPPLY_PROP_CURRENT_AVG:
 		if (chip->pdata->enable_current_sense) {
-			ret = regmap_read(map, MAX17042_AvgCurrent, &data);
+			ret = max17042_read_cached(chip, MAX17042_AvgCurrent, &data);
 			if (ret < 0)
 				return ret;
 
-			data64 = sign_extend64(data, 15) * 1562500ll;
-			val->intval = div_s64(data64, chip->pdata->r_sns);
+			val->intval = max17042_scale(chip->current_scale,
+						     sign_extend32(data, 15));
 		} else {
 			return -EINVAL;
 		}
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_TERM_CURRENT:
-		ret = regmap_read(map, MAX17042_ICHGTerm, &data);
+		ret = max17042_read_cached(chip, MAX17042_ICHGTerm, &data);
 		if (ret < 0)
 			return ret;
 
-		data64 = data * 1562500ll;
-		val->intval = div_s64(data64, chip->pdata->r_sns);
+		val->intval = max17042_scale(chip->current_scale, data);
 		break;
 	case POWER_SUPPLY_PROP_TIME_TO_EMPTY_NOW:
-		ret = regmap_read(map, MAX17042_TTE, &data);
+		ret = max17042_read_cached(chip, MAX17042_TTE, &data);
+		if (ret < 0)
+			return ret;
+
+		val->intval = data * 5625 / 1000;
+		break;
+	case POWER_SUPPLY_PROP_TIME_TO_FULL_NOW:
+		ret = max17042_read_cached(chip, MAX17055_TTF, &data);
 		if (ret < 0)
 			return ret;
 
+		/* TTF reads 0xffff while the cell is not charging */
+		if (data == 0xffff)
+			return -ENODATA;
+
 		val->intval = data * 5625 / 1000;
 		break;
+	case POWER_SUPPLY_PROP_POWER_NOW:
+	case POWER_SUPPLY_PROP_POWER_AVG:
+		ret = max17042_read_cached(chip,
+					   psp == POWER_SUPPLY_PROP_POWER_NOW ?
+					   MAX17055_POWER : MAX17055_AvgPower,
+					   &data);
+		if (ret < 0)
+			return ret;
+
+		val->intval = max17042_scale(chip->power_scale,
+					     sign_extend32(data, 15));
+		break;
 	default:
 		return -EINVAL;
 	}
 	return 0;
 }
 
+static int max17042_get_property(struct power_supply *psy,
+			    enum power_supply_property psp,
+			    union power_supply_propval *val)
+{
+	struct max17042_chip *chip = power_supply_get_drvdata(psy);
+	struct device *dev = &chip->client->dev;
+	u64 start = ktime_get_ns();
+	int ret;
+
+	trace_max17042_get_property_start(dev, psp);
+	ret = __max17042_get_property(chip, psp, val);
+	trace_max17042_get_property_done(dev, psp, ret ? 0 : val->intval,
+					 ktime_get_ns() - start, ret);
+
+	return ret;
+}
+
 static int max17042_set_property(struct power_supply *psy,
 			    enum power_supply_property psp,
 			    const union power_supply_propval *val)
@@ -479,6 +794,9 @@ static int max17042_set_property(struct power_supply *psy,
 		ret = -EINVAL;
 	}
 
+	if (!ret && chip->pdata->snapshot_interval_ms)
+		max17042_snapshot_refresh(chip);
+
 	return ret;
 }
 
@@ -546,25 +864,14 @@ static inline void max17042_lock_model(struct max17042_chip *chip)
 static inline void max17042_write_model_data(struct max17042_chip *chip,
 					u8 addr, int size)
 {
-	struct regmap *map = chip->regmap;
-	int i;
-
-	for (i = 0; i < size; i++)
-		regmap_write(map, addr + i,
-			chip->pdata->config_data->cell_char_tbl[i]);
+	regmap_bulk_write(chip->regmap, addr,
+			  chip->pdata->config_data->cell_char_tbl, size);
 }
 
 static inline void max17042_read_model_data(struct max17042_chip *chip,
 					u8 addr, u16 *data, int size)
 {
-	struct regmap *map = chip->regmap;
-	int i;
-	u32 tmp;
-
-	for (i = 0; i < size; i++) {
-		regmap_read(map, addr + i, &tmp);
-		data[i] = (u16)tmp;
-	}
+	regmap_bulk_read(chip->regmap, addr, data, size);
 }
 
 static inline int max17042_model_data_compare(struct max17042_chip *chip,
@@ -642,9 +949,7 @@ static void max17042_write_config_regs(struct max17042_chip *chip)
 	regmap_write(map, MAX17042_FilterCFG,
 			config->filter_cfg);
 	regmap_write(map, MAX17042_RelaxCFG, config->relax_cfg);
-	if (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17047 ||
-			chip->chip_type == MAXIM_DEVICE_TYPE_MAX17050 ||
-			chip->chip_type == MAXIM_DEVICE_TYPE_MAX17055)
+	if (chip->info->has_full_soc_thr)
 		regmap_write(map, MAX17047_FullSOCThr,
 						config->full_soc_thresh);
 }
@@ -657,11 +962,7 @@ static void  max17042_write_custom_regs(struct max17042_chip *chip)
 	max17042_write_verify_reg(map, MAX17042_RCOMP0, config->rcomp0);
 	max17042_write_verify_reg(map, MAX17042_TempCo,	config->tcompc0);
 	max17042_write_verify_reg(map, MAX17042_ICHGTerm, config->ichgt_term);
-	if (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17042) {
-		regmap_write(map, MAX17042_EmptyTempCo,	config->empty_tempco);
-		max17042_write_verify_reg(map, MAX17042_K_empty0,
-					config->kempty0);
-	} else {
+	if (chip->info->has_qrtbl) {
 		max17042_write_verify_reg(map, MAX17047_QRTbl00,
 						config->qrtbl00);
 		max17042_write_verify_reg(map, MAX17047_QRTbl10,
@@ -670,6 +971,10 @@ static void  max17042_write_custom_regs(struct max17042_chip *chip)
 						config->qrtbl20);
 		max17042_write_verify_reg(map, MAX17047_QRTbl30,
 						config->qrtbl30);
+	} else {
+		regmap_write(map, MAX17042_EmptyTempCo,	config->empty_tempco);
+		max17042_write_verify_reg(map, MAX17042_K_empty0,
+					config->kempty0);
 	}
 }
 
@@ -737,62 +1042,103 @@ static void max17042_load_new_capacity_params(struct max17042_chip *chip)
  * This function MUST be called before the POR initialization procedure
  * specified by maxim.
  */
-static inline void max17042_override_por_values(struct max17042_chip *chip)
+static inline void max17042_override_por_values(struct max17042_chip *chip,
+				const struct max17042_config_data *config_data)
+{
+	const struct max17042_chip_info *info = chip->info;
+	const u8 *config = (const u8 *)config_data;
+	int i;
+
+	for (i = 0; i < info->num_por_regs; i++)
+		max17042_override_por(chip->regmap, info->por_regs[i].reg,
+				      get_unaligned((const u16 *)
+					(config + info->por_regs[i].offset)));
+}
+
+static u16 max17042_learned_crc(const struct max17042_learned *learned)
+{
+	return crc16(0, (const u8 *)learned,
+		     offsetof(struct max17042_learned, crc));
+}
+
+static int max17042_learned_validate(struct max17042_chip *chip,
+				     const void *buf, size_t len)
+{
+	const struct max17042_learned *learned = buf;
+
+	if (len != sizeof(*learned) ||
+	    le16_to_cpu(learned->magic) != MAX17042_LEARNED_MAGIC ||
+	    learned->version != MAX17042_LEARNED_VERSION ||
+	    learned->chip_type != chip->chip_type)
+		return -EINVAL;
+
+	if (le16_to_cpu(learned->crc) != max17042_learned_crc(learned))
+		return -EBADMSG;
+
+	return 0;
+}
+
+static int max17042_learned_save(struct max17042_chip *chip,
+				 struct max17042_learned *learned)
+{
+	struct regmap *map = chip->regmap;
+	u16 cap[MAX17042_FullCAPNom - MAX17042_FullCAP + 1];
+	u16 rcomp[2];
+	u32 qh;
+	int ret;
+
+	/* FullCAP, Cycles and FullCAPNom share one window */
+	ret = regmap_bulk_read(map, MAX17042_FullCAP, cap, ARRAY_SIZE(cap));
+	if (!ret)
+		ret = regmap_bulk_read(map, MAX17042_RCOMP0, rcomp,
+				       ARRAY_SIZE(rcomp));
+	if (!ret)
+		ret = regmap_read(map, MAX17042_QH, &qh);
+	if (ret < 0)
+		return ret;
+
+	learned->magic = cpu_to_le16(MAX17042_LEARNED_MAGIC);
+	learned->version = MAX17042_LEARNED_VERSION;
+	learned->chip_type = chip->chip_type;
+	learned->rcomp0 = cpu_to_le16(rcomp[0]);
+	learned->tempco = cpu_to_le16(rcomp[1]);
+	learned->fullcap = cpu_to_le16(cap[0]);
+	learned->fullcapnom = cpu_to_le16(cap[MAX17042_FullCAPNom -
+					      MAX17042_FullCAP]);
+	learned->cycles = cpu_to_le16(cap[MAX17042_Cycles - MAX17042_FullCAP]);
+	learned->qh = cpu_to_le16(qh);
+	learned->crc = cpu_to_le16(max17042_learned_crc(learned));
+
+	return 0;
+}
+
+/*
+ * Write back previously learned parameters so that the gauge continues from
+ * its converged state instead of relearning the cell from the defaults.
+ */
+static void max17042_learned_restore(struct max17042_chip *chip)
 {
+	const struct max17042_learned *learned = &chip->learned;
 	struct regmap *map = chip->regmap;
-	struct max17042_config_data *config = chip->pdata->config_data;
+	u16 fullcapnom = le16_to_cpu(learned->fullcapnom);
 
-	max17042_override_por(map, MAX17042_TGAIN, config->tgain);
-	max17042_override_por(map, MAX17042_TOFF, config->toff);
-	max17042_override_por(map, MAX17042_CGAIN, config->cgain);
-	max17042_override_por(map, MAX17042_COFF, config->coff);
-
-	max17042_override_por(map, MAX17042_VALRT_Th, config->valrt_thresh);
-	max17042_override_por(map, MAX17042_TALRT_Th, config->talrt_thresh);
-	max17042_override_por(map, MAX17042_SALRT_Th,
-						config->soc_alrt_thresh);
-	max17042_override_por(map, MAX17042_CONFIG, config->config);
-	max17042_override_por(map, MAX17042_SHDNTIMER, config->shdntimer);
-
-	max17042_override_por(map, MAX17042_DesignCap, config->design_cap);
-	max17042_override_por(map, MAX17042_ICHGTerm, config->ichgt_term);
-
-	max17042_override_por(map, MAX17042_AtRate, config->at_rate);
-	max17042_override_por(map, MAX17042_LearnCFG, config->learn_cfg);
-	max17042_override_por(map, MAX17042_FilterCFG, config->filter_cfg);
-	max17042_override_por(map, MAX17042_RelaxCFG, config->relax_cfg);
-	max17042_override_por(map, MAX17042_MiscCFG, config->misc_cfg);
-
-	max17042_override_por(map, MAX17042_FullCAP, config->fullcap);
-	max17042_override_por(map, MAX17042_FullCAPNom, config->fullcapnom);
-	max17042_override_por(map, MAX17042_dQacc, config->dqacc);
-	max17042_override_por(map, MAX17042_dPacc, config->dpacc);
-
-	max17042_override_por(map, MAX17042_RCOMP0, config->rcomp0);
-	max17042_override_por(map, MAX17042_TempCo, config->tcompc0);
-
-	if (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17042) {
-		max17042_override_por(map, MAX17042_MaskSOC, config->masksoc);
-		max17042_override_por(map, MAX17042_SOC_empty, config->socempty);
-		max17042_override_por(map, MAX17042_V_empty, config->vempty);
-		max17042_override_por(map, MAX17042_EmptyTempCo, config->empty_tempco);
-		max17042_override_por(map, MAX17042_K_empty0, config->kempty0);
-	}
+	max17042_write_verify_reg(map, MAX17042_RCOMP0,
+				  le16_to_cpu(learned->rcomp0));
+	max17042_write_verify_reg(map, MAX17042_TempCo,
+				  le16_to_cpu(learned->tempco));
+	max17042_write_verify_reg(map, MAX17042_FullCAPNom, fullcapnom);
 
-	if ((chip->chip_type == MAXIM_DEVICE_TYPE_MAX17042) ||
-	    (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17047) ||
-	    (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17050)) {
-		max17042_override_por(map, MAX17042_IAvg_empty, config->iavg_empty);
-		max17042_override_por(map, MAX17042_TempNom, config->temp_nom);
-		max17042_override_por(map, MAX17042_TempLim, config->temp_lim);
-		max17042_override_por(map, MAX17042_FCTC, config->fctc);
-	}
+	/* Restart the learning accumulators from the restored capacity */
+	max17042_write_verify_reg(map, MAX17042_dQacc,
+				  fullcapnom / dQ_ACC_DIV);
+	max17042_write_verify_reg(map, MAX17042_dPacc, dP_ACC_200);
 
-	if ((chip->chip_type == MAXIM_DEVICE_TYPE_MAX17047) ||
-	    (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17050) ||
-	    (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17055)) {
-		max17042_override_por(map, MAX17047_V_empty, config->vempty);
-	}
+	max17042_write_verify_reg(map, MAX17042_FullCAP,
+				  le16_to_cpu(learned->fullcap));
+	max17042_write_verify_reg(map, MAX17042_Cycles,
+				  le16_to_cpu(learned->cycles));
+	/* QH moves with every coulomb counted, so it cannot be verified */
+	regmap_write(map, MAX17042_QH, le16_to_cpu(learned->qh));
 }
 
 static int max17042_init_chip(struct max17042_chip *chip)
@@ -800,7 +1146,7 @@ static int max17042_init_chip(struct max17042_chip *chip)
 	struct regmap *map = chip->regmap;
 	int ret;
 
-	max17042_override_por_values(chip);
+	max17042_override_por_values(chip, chip->pdata->config_data);
 	/* After Power up, the MAX17042 requires 500mS in order
 	 * to perform signal debouncing and initial SOC reporting
 	 */
@@ -840,106 +1186,473 @@ static int max17042_init_chip(struct max17042_chip *chip)
 	/* load new capacity params */
 	max17042_load_new_capacity_params(chip);
 
+	mutex_lock(&chip->learned_lock);
+	if (chip->have_learned)
+		max17042_learned_restore(chip);
+	mutex_unlock(&chip->learned_lock);
+
 	/* Init complete, Clear the POR bit */
 	regmap_update_bits(map, MAX17042_STATUS, STATUS_POR_BIT, 0x0);
 	return 0;
 }
 
-static void max17042_set_soc_threshold(struct max17042_chip *chip, u16 off)
+/*
+ * ModelGauge m5 EZ initialization: the MAX17055 builds its own model from
+ * DesignCap, IChgTerm, VEmpty and ModelCfg, so only a handful of writes
+ * and a poll for ModelCfg.Refresh are needed instead of the MAX17042 model
+ * table load and fixed delays.
+ */
+static int max17055_init_chip(struct max17042_chip *chip)
 {
+	const struct max17055_ez_config *ez = &chip->ez;
 	struct regmap *map = chip->regmap;
-	u32 soc, soc_tr;
+	u32 val, hib_cfg;
+	int ret;
 
-	/* program interrupt thresholds such that we should
-	 * get interrupt for every 'off' perc change in the soc
-	 */
-	regmap_read(map, MAX17042_RepSOC, &soc);
-	soc >>= 8;
-	soc_tr = (soc + off) << 8;
-	if (off < soc)
-		soc_tr |= soc - off;
-	regmap_write(map, MAX17042_SALRT_Th, soc_tr);
+	/* Wait until the gauge has finished its startup measurements */
+	ret = regmap_read_poll_timeout(map, MAX17042_FSTAT, val,
+				       !(val & FSTAT_DNR_BIT),
+				       MAX17055_POLL_US,
+				       MAX17055_DNR_TIMEOUT_US);
+	if (ret)
+		return ret;
+
+	ret = regmap_read(map, MAX17055_HibCfg, &hib_cfg);
+	if (ret < 0)
+		return ret;
+
+	/* Exit hibernate so the configuration takes effect right away */
+	regmap_write(map, MAX17055_Command, CMD_SOFT_WAKEUP);
+	regmap_write(map, MAX17055_HibCfg, HIBCFG_DISABLE);
+	regmap_write(map, MAX17055_Command, CMD_CLEAR);
+
+	regmap_write(map, MAX17042_DesignCap, ez->design_cap);
+	regmap_write(map, MAX17042_dQacc, ez->dqacc);
+	regmap_write(map, MAX17042_ICHGTerm, ez->ichg_term);
+	regmap_write(map, MAX17047_V_empty, ez->vempty);
+	regmap_write(map, MAX17042_dPacc, ez->dpacc);
+	regmap_write(map, MAX17055_ModelCfg,
+		     ez->model_cfg | MODELCFG_REFRESH_BIT);
+
+	ret = regmap_read_poll_timeout(map, MAX17055_ModelCfg, val,
+				       !(val & MODELCFG_REFRESH_BIT),
+				       MAX17055_POLL_US,
+				       MAX17055_REFRESH_TIMEOUT_US);
+	if (ret) {
+		dev_err(&chip->client->dev, "%s model refresh timed out\n",
+			__func__);
+		goto out;
+	}
+
+	mutex_lock(&chip->learned_lock);
+	if (chip->have_learned)
+		max17042_learned_restore(chip);
+	mutex_unlock(&chip->learned_lock);
+
+	/* Init complete, Clear the POR bit */
+	ret = regmap_update_bits(map, MAX17042_STATUS, STATUS_POR_BIT, 0x0);
+out:
+	regmap_write(map, MAX17055_HibCfg, hib_cfg);
+	return ret;
 }
 
-static irqreturn_t max17042_thread_handler(int id, void *dev)
+/*
+ * Turn the simple-battery description into register values once, at probe
+ * time. MAX17055 gets its EZ configuration; the other variants get a set of
+ * POR overrides applied by max17042_init_worker() when the platform did not
+ * provide a full config_data.
+ */
+static int max17042_get_battery_config(struct max17042_chip *chip)
 {
-	struct max17042_chip *chip = dev;
-	u32 val;
+	struct device *dev = &chip->client->dev;
+	struct power_supply_battery_info *info;
+	struct max17042_config_data *config;
+	u32 r_sns = chip->pdata->r_sns;
+	u16 design_cap, ichg_term, vempty;
+	u64 cap, term = 0;
+	bool vchg;
 	int ret;
 
-	ret = regmap_read(chip->regmap, MAX17042_STATUS, &val);
+	if (!chip->info->has_ez_config && chip->pdata->config_data)
+		return 0;
+
+	ret = power_supply_get_battery_info(chip->battery, &info);
 	if (ret)
-		return IRQ_HANDLED;
+		return ret == -EPROBE_DEFER ? ret : 0;
 
-	if ((val & STATUS_SMN_BIT) || (val & STATUS_SMX_BIT)) {
-		dev_dbg(&chip->client->dev, "SOC threshold INTR\n");
-		max17042_set_soc_threshold(chip, 1);
+	/* Health limits not given as maxim,* properties come from the cell */
+	if (chip->pdata->vmin == INT_MIN && info->voltage_min_design_uv > 0)
+		chip->pdata->vmin = info->voltage_min_design_uv / 1000;
+	if (chip->pdata->vmax == INT_MAX && info->voltage_max_design_uv > 0)
+		chip->pdata->vmax = info->voltage_max_design_uv / 1000;
+
+	if (info->charge_full_design_uah <= 0 ||
+	    info->voltage_min_design_uv <= 0) {
+		dev_warn(dev, "battery info lacks capacity or empty voltage\n");
+		goto out;
 	}
 
-	/* we implicitly handle all alerts via power_supply_changed */
-	regmap_clear_bits(chip->regmap, MAX17042_STATUS,
-			  0xFFFF & ~(STATUS_POR_BIT | STATUS_BST_BIT));
+	/* Capacity LSB = 5 uVh / r_sns, current LSB = 1.5625 uV / r_sns */
+	cap = div_u64((u64)info->charge_full_design_uah * r_sns, 5000000);
+	if (info->charge_term_current_ua > 0)
+		term = div_u64((u64)info->charge_term_current_ua * r_sns,
+			       1562500);
+	/* Both are 16-bit registers; a wrapped value would mislead the gauge */
+	if (cap > U16_MAX || term > U16_MAX) {
+		dev_warn(dev, "battery capacity or charge termination current out of range\n");
+		goto out;
+	}
+	design_cap = cap;
+	ichg_term = term;
+	/* VE in 10mV units, keep the datasheet default recovery voltage */
+	vempty = (info->voltage_min_design_uv / 10000) << VEMPTY_VE_SHIFT |
+		 VEMPTY_VR_DEFAULT;
+	vchg = info->constant_charge_voltage_max_uv > MAX17055_VCHG_THRESHOLD ||
+	       info->voltage_max_design_uv > MAX17055_VCHG_THRESHOLD;
+
+	if (info->ocv_table_size[0] > 0)
+		dev_dbg(dev, "OCV table unused, gauge uses its own model\n");
+
+	if (!design_cap)
+		goto out;
 
-	power_supply_changed(chip->battery);
-	return IRQ_HANDLED;
-}
+	if (chip->info->has_ez_config) {
+		struct max17055_ez_config *ez = &chip->ez;
 
-static void max17042_init_worker(struct work_struct *work)
-{
-	struct max17042_chip *chip = container_of(work,
-				struct max17042_chip, work);
-	int ret;
+		ez->dqacc = design_cap / 32;
+		ez->dpacc = ez->dqacc * (vchg ? 51200 : 44138) / design_cap;
+		ez->ichg_term = ichg_term;
+		ez->vempty = vempty;
+		ez->model_cfg = vchg ? MODELCFG_VCHG_BIT : 0;
+		/* Set last, it marks the EZ configuration as valid */
+		ez->design_cap = design_cap;
+		goto out;
+	}
 
-	/* Initialize registers according to values from the platform data */
-	if (chip->pdata->enable_por_init && chip->pdata->config_data) {
-		ret = max17042_init_chip(chip);
-		if (ret)
-			return;
+	config = devm_kzalloc(dev, sizeof(*config), GFP_KERNEL);
+	if (!config) {
+		ret = -ENOMEM;
+		goto out;
 	}
 
-	chip->init_complete = 1;
+	config->design_cap = design_cap;
+	config->fullcap = design_cap;
+	config->fullcapnom = design_cap;
+	config->dqacc = design_cap / dQ_ACC_DIV;
+	config->dpacc = dP_ACC_200;
+	config->ichgt_term = ichg_term;
+	config->vempty = vempty;
+	chip->batt_config = config;
+out:
+	power_supply_put_battery_info(chip->battery, info);
+	return ret;
 }
 
-#ifdef CONFIG_OF
-static struct max17042_platform_data *
-max17042_get_of_pdata(struct max17042_chip *chip)
+static u32 max17042_soc_window(u32 soc, u16 off)
 {
-	struct device *dev = &chip->client->dev;
-	struct device_node *np = dev->of_node;
-	u32 prop;
-	struct max17042_platform_data *pdata;
+	u32 soc_tr;
 
-	pdata = devm_kzalloc(dev, sizeof(*pdata), GFP_KERNEL);
-	if (!pdata)
-		return NULL;
+	soc_tr = (soc + off) << 8;
+	if (off < soc)
+		soc_tr |= soc - off;
 
-	/*
-	 * Require current sense resistor value to be specified for
-	 * current-sense functionality to be enabled at all.
-	 */
-	if (of_property_read_u32(np, "maxim,rsns-microohm", &prop) == 0) {
-		pdata->r_sns = prop;
-		pdata->enable_current_sense = true;
-	}
+	return soc_tr;
+}
 
-	if (of_property_read_s32(np, "maxim,cold-temp", &pdata->temp_min))
-		pdata->temp_min = INT_MIN;
-	if (of_property_read_s32(np, "maxim,over-heat-temp", &pdata->temp_max))
-		pdata->temp_max = INT_MAX;
-	if (of_property_read_s32(np, "maxim,dead-volt", &pdata->vmin))
-		pdata->vmin = INT_MIN;
-	if (of_property_read_s32(np, "maxim,over-volt", &pdata->vmax))
-		pdata->vmax = INT_MAX;
+static void max17042_set_soc_threshold(struct max17042_chip *chip, u16 off)
+{
+	struct regmap *map = chip->regmap;
+	u32 soc;
 
-	return pdata;
+	/* program interrupt thresholds such that we should
+	 * get interrupt for every 'off' perc change in the soc
+	 */
+	regmap_read(map, MAX17042_RepSOC, &soc);
+	regmap_write(map, MAX17042_SALRT_Th, max17042_soc_window(soc >> 8, off));
 }
-#endif
 
-static struct max17042_reg_data max17047_default_pdata_init_regs[] = {
-	/*
-	 * Some firmwares do not set FullSOCThr, Enable End-of-Charge Detection
-	 * when the voltage FG reports 95%, as recommended in the datasheet.
-	 */
+/*
+ * Use the MAX17055 1% SOC change alert instead of re-arming the SALRT_Th
+ * window from the IRQ handler on every crossing.
+ */
+static int max17042_enable_dsoc_alert(struct max17042_chip *chip)
+{
+	int ret;
+
+	ret = regmap_update_bits(chip->regmap, MAX17055_Config2,
+				 CONFIG2_DSOCEN_BIT, CONFIG2_DSOCEN_BIT);
+	if (ret < 0)
+		return ret;
+
+	/* Park the SOC window so that only dSOCi reports SOC changes */
+	return regmap_write(chip->regmap, MAX17042_SALRT_Th, 0xff00);
+}
+
+static bool max17042_notify_delta(int now, int last, unsigned int delta)
+{
+	return delta && abs(now - last) >= delta;
+}
+
+/*
+ * Every notification makes udev, upower and friends re-read all properties,
+ * so only pass on changes that clear one of the configured SOC, voltage or
+ * current deltas, and no more often than the minimum interval. Notifications
+ * falling inside the interval are postponed rather than dropped. With no
+ * deltas and no interval configured every call notifies, as before.
+ */
+static void max17042_notify(struct max17042_chip *chip, bool force)
+{
+	struct max17042_platform_data *pdata = chip->pdata;
+	unsigned long next;
+	int soc = 0, mv = 0, ma = 0;
+	u32 data;
+
+	mutex_lock(&chip->notify_lock);
+	force |= chip->notify_force;
+	chip->notify_force = false;
+
+	/* Alerts come through here, only read what a delta compares */
+	if (pdata->notify_delta_soc &&
+	    !max17042_read_cached(chip, chip->soc_reg, &data))
+		soc = data >> 8;
+	if (pdata->notify_delta_mv &&
+	    !max17042_read_cached(chip, MAX17042_VCELL, &data))
+		mv = data * 625 / 8000;
+	if (pdata->notify_delta_ma && pdata->enable_current_sense &&
+	    !max17042_read_cached(chip, MAX17042_AvgCurrent, &data))
+		ma = max17042_scale(chip->current_scale,
+				    sign_extend32(data, 15)) / 1000;
+
+	if (!force &&
+	    (pdata->notify_delta_soc || pdata->notify_delta_mv ||
+	     pdata->notify_delta_ma) &&
+	    !max17042_notify_delta(soc, chip->notify_soc,
+				   pdata->notify_delta_soc) &&
+	    !max17042_notify_delta(mv, chip->notify_mv,
+				   pdata->notify_delta_mv) &&
+	    !max17042_notify_delta(ma, chip->notify_ma,
+				   pdata->notify_delta_ma)) {
+		chip->stats.notify_suppressed++;
+		goto out;
+	}
+
+	next = chip->notify_last +
+	       msecs_to_jiffies(pdata->notify_min_interval_ms);
+	if (pdata->notify_min_interval_ms && time_before(jiffies, next)) {
+		/* Already judged worth sending, the worker must not drop it */
+		chip->notify_force = true;
+		schedule_delayed_work(&chip->notify_work, next - jiffies);
+		chip->stats.notify_deferred++;
+		goto out;
+	}
+
+	chip->notify_last = jiffies;
+	chip->notify_soc = soc;
+	chip->notify_mv = mv;
+	chip->notify_ma = ma;
+	chip->stats.notify_sent++;
+	mutex_unlock(&chip->notify_lock);
+
+	power_supply_changed(chip->battery);
+	return;
+out:
+	mutex_unlock(&chip->notify_lock);
+}
+
+static void max17042_arm_alerts(struct max17042_chip *chip)
+{
+	regmap_update_bits(chip->regmap, MAX17042_CONFIG,
+			   CONFIG_ALRT_BIT_ENBL, CONFIG_ALRT_BIT_ENBL);
+	chip->dsoc_alert = chip->info->has_dsoc_alert &&
+			   !max17042_enable_dsoc_alert(chip);
+	if (!chip->dsoc_alert)
+		max17042_set_soc_threshold(chip, 1);
+}
+
+static void max17042_notify_worker(struct work_struct *work)
+{
+	struct max17042_chip *chip = container_of(work, struct max17042_chip,
+						  notify_work.work);
+
+	max17042_notify(chip, false);
+}
+
+static void max17042_external_power_changed(struct power_supply *psy)
+{
+	struct max17042_chip *chip = power_supply_get_drvdata(psy);
+
+	/* Nothing to filter against until the gauge has been set up */
+	if (!chip->init_complete) {
+		power_supply_changed(psy);
+		return;
+	}
+
+	/* Charger plug and unplug always change the reported status */
+	max17042_notify(chip, true);
+}
+
+static irqreturn_t max17042_thread_handler(int id, void *dev)
+{
+	struct max17042_chip *chip = dev;
+	unsigned int coalesce_ms = chip->pdata->alert_coalesce_ms;
+	u64 start = ktime_get_ns();
+	bool force;
+	u32 val;
+	int ret, bit;
+
+	ret = regmap_read(chip->regmap, MAX17042_STATUS, &val);
+	if (ret)
+		return IRQ_HANDLED;
+
+	chip->stats.irqs++;
+	for (bit = 0; bit < ARRAY_SIZE(chip->stats.irq_status); bit++)
+		if (val & BIT(bit))
+			chip->stats.irq_status[bit]++;
+
+	if (val & STATUS_DSOCI_BIT)
+		dev_dbg(&chip->client->dev, "SOC change INTR\n");
+
+	if (!chip->dsoc_alert &&
+	    ((val & STATUS_SMN_BIT) || (val & STATUS_SMX_BIT))) {
+		dev_dbg(&chip->client->dev, "SOC threshold INTR\n");
+		max17042_set_soc_threshold(chip, 1);
+	}
+
+	/* we implicitly handle all alerts via power_supply_changed */
+	regmap_clear_bits(chip->regmap, MAX17042_STATUS,
+			  0xFFFF & ~(STATUS_POR_BIT | STATUS_BST_BIT));
+
+	/* Readers woken by the notification should see post-alert values */
+	if (chip->pdata->snapshot_interval_ms && chip->init_complete)
+		max17042_snapshot_refresh(chip);
+
+	/* Battery insertion/removal and threshold alerts bypass the deltas */
+	force = val & (STATUS_BI_BIT | STATUS_BR_BIT | STATUS_VMN_BIT |
+		       STATUS_VMX_BIT | STATUS_TMN_BIT | STATUS_TMX_BIT);
+
+	/*
+	 * A pending notification already covers this alert, so bursts within
+	 * the coalescing window collapse into a single power_supply_changed.
+	 */
+	if (coalesce_ms) {
+		if (force) {
+			mutex_lock(&chip->notify_lock);
+			chip->notify_force = true;
+			mutex_unlock(&chip->notify_lock);
+		}
+		schedule_delayed_work(&chip->notify_work,
+				      msecs_to_jiffies(coalesce_ms));
+	} else {
+		max17042_notify(chip, force);
+	}
+
+	trace_max17042_irq(&chip->client->dev, val, ktime_get_ns() - start);
+	return IRQ_HANDLED;
+}
+
+static void max17042_init_worker(struct work_struct *work)
+{
+	struct max17042_chip *chip = container_of(work,
+				struct max17042_chip, work);
+	u64 start;
+	int ret;
+
+	/*
+	 * Initialize registers according to the simple-battery EZ settings
+	 * on MAX17055, or to values from the platform data.
+	 */
+	if (chip->ez.design_cap ||
+	    (chip->pdata->enable_por_init && chip->pdata->config_data)) {
+		start = ktime_get_ns();
+		if (chip->ez.design_cap)
+			ret = max17055_init_chip(chip);
+		else
+			ret = max17042_init_chip(chip);
+		trace_max17042_init_chip(&chip->client->dev,
+					 ktime_get_ns() - start, ret);
+		if (ret)
+			return;
+	} else {
+		/*
+		 * Firmware owns the model, only apply what simple-battery
+		 * described and what was learned.
+		 */
+		if (chip->batt_config)
+			max17042_override_por_values(chip, chip->batt_config);
+
+		mutex_lock(&chip->learned_lock);
+		if (chip->have_learned)
+			max17042_learned_restore(chip);
+		mutex_unlock(&chip->learned_lock);
+
+		if (chip->batt_config || chip->have_learned)
+			regmap_update_bits(chip->regmap, MAX17042_STATUS,
+					   STATUS_POR_BIT, 0x0);
+	}
+
+	/* The Config image written above, or a POR, may have dropped them */
+	if (chip->client->irq)
+		max17042_arm_alerts(chip);
+
+	chip->init_complete = 1;
+	if (chip->pdata->snapshot_interval_ms)
+		mod_delayed_work(system_freezable_power_efficient_wq,
+				 &chip->snap_work, 0);
+}
+
+#ifdef CONFIG_OF
+static struct max17042_platform_data *
+max17042_get_of_pdata(struct max17042_chip *chip)
+{
+	struct device *dev = &chip->client->dev;
+	struct device_node *np = dev->of_node;
+	u32 prop;
+	struct max17042_platform_data *pdata;
+
+	pdata = devm_kzalloc(dev, sizeof(*pdata), GFP_KERNEL);
+	if (!pdata)
+		return NULL;
+
+	/*
+	 * Require current sense resistor value to be specified for
+	 * current-sense functionality to be enabled at all.
+	 */
+	if (of_property_read_u32(np, "maxim,rsns-microohm", &prop) == 0) {
+		pdata->r_sns = prop;
+		pdata->enable_current_sense = true;
+	}
+
+	if (of_property_read_s32(np, "maxim,cold-temp", &pdata->temp_min))
+		pdata->temp_min = INT_MIN;
+	if (of_property_read_s32(np, "maxim,over-heat-temp", &pdata->temp_max))
+		pdata->temp_max = INT_MAX;
+	if (of_property_read_s32(np, "maxim,dead-volt", &pdata->vmin))
+		pdata->vmin = INT_MIN;
+	if (of_property_read_s32(np, "maxim,over-volt", &pdata->vmax))
+		pdata->vmax = INT_MAX;
+	of_property_read_u32(np, "maxim,alert-coalesce-ms",
+			     &pdata->alert_coalesce_ms);
+	of_property_read_u32(np, "maxim,notify-min-interval-ms",
+			     &pdata->notify_min_interval_ms);
+	of_property_read_u32(np, "maxim,notify-delta-soc",
+			     &pdata->notify_delta_soc);
+	of_property_read_u32(np, "maxim,notify-delta-mv",
+			     &pdata->notify_delta_mv);
+	of_property_read_u32(np, "maxim,notify-delta-ma",
+			     &pdata->notify_delta_ma);
+	pdata->snapshot_interval_ms = MAX17042_DEFAULT_SNAPSHOT_INTERVAL;
+	of_property_read_u32(np, "maxim,snapshot-interval-ms",
+			     &pdata->snapshot_interval_ms);
+
+	return pdata;
+}
+#endif
+
+static const struct max17042_reg_data max17047_default_pdata_init_regs[] = {
+	/*
+	 * Some firmwares do not set FullSOCThr, Enable End-of-Charge Detection
+	 * when the voltage FG reports 95%, as recommended in the datasheet.
+	 */
 	{ MAX17047_FullSOCThr, MAX17042_BATTERY_FULL << 8 },
 };
 
@@ -959,12 +1672,8 @@ max17042_get_default_pdata(struct max17042_chip *chip)
 	if (!pdata)
 		return pdata;
 
-	if ((chip->chip_type == MAXIM_DEVICE_TYPE_MAX17047) ||
-	    (chip->chip_type == MAXIM_DEVICE_TYPE_MAX17050)) {
-		pdata->init_data = max17047_default_pdata_init_regs;
-		pdata->num_init_data =
-			ARRAY_SIZE(max17047_default_pdata_init_regs);
-	}
+	pdata->init_data = chip->info->default_init_regs;
+	pdata->num_init_data = chip->info->num_default_init_regs;
 
 	ret = regmap_read(chip->regmap, MAX17042_MiscCFG, &misc_cfg);
 	if (ret < 0)
@@ -980,6 +1689,7 @@ max17042_get_default_pdata(struct max17042_chip *chip)
 	pdata->vmax = MAX17042_DEFAULT_VMAX;
 	pdata->temp_min = MAX17042_DEFAULT_TEMP_MIN;
 	pdata->temp_max = MAX17042_DEFAULT_TEMP_MAX;
+	pdata->snapshot_interval_ms = MAX17042_DEFAULT_SNAPSHOT_INTERVAL;
 
 	return pdata;
 }
@@ -999,19 +1709,808 @@ max17042_get_pdata(struct max17042_chip *chip)
 	return max17042_get_default_pdata(chip);
 }
 
+#if IS_REACHABLE(CONFIG_IIO_TRIGGERED_BUFFER)
+/*
+ * TEMP, VCELL, Current and AvgCurrent are adjacent registers, so a scan of
+ * any of them costs one bulk read. Power lives at 0xB1 on the MAX17055.
+ */
+enum max17042_iio_scan {
+	MAX17042_IIO_TEMP,
+	MAX17042_IIO_VCELL,
+	MAX17042_IIO_CURRENT,
+	MAX17042_IIO_AVG_CURRENT,
+	MAX17042_IIO_POWER,
+	MAX17042_IIO_TIMESTAMP,
+};
+
+#define MAX17042_IIO_NUM_MEAS	(MAX17042_IIO_AVG_CURRENT + 1)
+
+struct max17042_iio {
+	struct max17042_chip *chip;
+	struct {
+		s16 chans[MAX17042_IIO_POWER + 1];
+		aligned_s64 timestamp;
+	} scan;
+};
+
+#define MAX17042_IIO_CHAN(_type, _chan, _reg, _si, _sign) {		\
+	.type = (_type),						\
+	.indexed = 1,							\
+	.channel = (_chan),						\
+	.address = (_reg),						\
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) |			\
+			      BIT(IIO_CHAN_INFO_SCALE),			\
+	.scan_index = (_si),						\
+	.scan_type = {							\
+		.sign = (_sign),					\
+		.realbits = 16,						\
+		.storagebits = 16,					\
+		.endianness = IIO_CPU,					\
+	},								\
+}
+
+/* in_current0 is the instantaneous current, in_current1 AvgCurrent */
+#define MAX17042_IIO_COMMON_CHANNELS					\
+	MAX17042_IIO_CHAN(IIO_TEMP, 0, MAX17042_TEMP,			\
+			  MAX17042_IIO_TEMP, 's'),			\
+	MAX17042_IIO_CHAN(IIO_VOLTAGE, 0, MAX17042_VCELL,		\
+			  MAX17042_IIO_VCELL, 'u'),			\
+	MAX17042_IIO_CHAN(IIO_CURRENT, 0, MAX17042_Current,		\
+			  MAX17042_IIO_CURRENT, 's'),			\
+	MAX17042_IIO_CHAN(IIO_CURRENT, 1, MAX17042_AvgCurrent,		\
+			  MAX17042_IIO_AVG_CURRENT, 's')
+
+static const struct iio_chan_spec max17042_iio_channels[] = {
+	MAX17042_IIO_COMMON_CHANNELS,
+	IIO_CHAN_SOFT_TIMESTAMP(MAX17042_IIO_TIMESTAMP),
+};
+
+static const struct iio_chan_spec max17055_iio_channels[] = {
+	MAX17042_IIO_COMMON_CHANNELS,
+	MAX17042_IIO_CHAN(IIO_POWER, 0, MAX17055_POWER,
+			  MAX17042_IIO_POWER, 's'),
+	IIO_CHAN_SOFT_TIMESTAMP(MAX17042_IIO_TIMESTAMP),
+};
+
+static int max17042_iio_read_raw(struct iio_dev *indio_dev,
+				 struct iio_chan_spec const *chan,
+				 int *val, int *val2, long mask)
+{
+	struct max17042_iio *iio = iio_priv(indio_dev);
+	struct max17042_chip *chip = iio->chip;
+	u32 data;
+	int ret;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		ret = regmap_read(chip->regmap, chan->address, &data);
+		if (ret < 0)
+			return ret;
+
+		if (chan->scan_type.sign == 's')
+			*val = sign_extend32(data, 15);
+		else
+			*val = data;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		switch (chan->type) {
+		case IIO_TEMP:
+			/* Units of LSB = 1 / 256 degree Celsius */
+			*val = 1000;
+			*val2 = 256;
+			return IIO_VAL_FRACTIONAL;
+		case IIO_VOLTAGE:
+			/* Units of LSB = 78.125 uV */
+			*val = 625;
+			*val2 = 8000;
+			return IIO_VAL_FRACTIONAL;
+		case IIO_CURRENT:
+			/* Units of LSB = 1.5625 uV / r_sns, in mA */
+			*val = 3125;
+			*val2 = 2 * chip->pdata->r_sns;
+			return IIO_VAL_FRACTIONAL;
+		case IIO_POWER:
+			/* Units of LSB = 0.8 mW with a 10 mOhm r_sns */
+			*val = 8000;
+			*val2 = chip->pdata->r_sns;
+			return IIO_VAL_FRACTIONAL;
+		default:
+			return -EINVAL;
+		}
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct iio_info max17042_iio_info = {
+	.read_raw = max17042_iio_read_raw,
+};
+
+static irqreturn_t max17042_iio_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct max17042_iio *iio = iio_priv(indio_dev);
+	struct regmap *map = iio->chip->regmap;
+	const unsigned long *mask = indio_dev->active_scan_mask;
+	u16 meas[MAX17042_IIO_NUM_MEAS];
+	u32 power = 0;
+	int i = 0;
+	int bit;
+
+	if (find_first_bit(mask, MAX17042_IIO_NUM_MEAS) <
+	    MAX17042_IIO_NUM_MEAS) {
+		if (regmap_bulk_read(map, MAX17042_TEMP, meas,
+				     MAX17042_IIO_NUM_MEAS) < 0)
+			goto done;
+	}
+
+	if (test_bit(MAX17042_IIO_POWER, mask)) {
+		if (regmap_read(map, MAX17055_POWER, &power) < 0)
+			goto done;
+	}
+
+	iio_for_each_active_channel(indio_dev, bit) {
+		if (bit == MAX17042_IIO_POWER)
+			iio->scan.chans[i++] = power;
+		else
+			iio->scan.chans[i++] = meas[bit];
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &iio->scan,
+					   pf->timestamp);
+done:
+	iio_trigger_notify_done(indio_dev->trig);
+	return IRQ_HANDLED;
+}
+
+static int max17042_iio_register(struct max17042_chip *chip)
+{
+	struct device *dev = &chip->client->dev;
+	struct iio_dev *indio_dev;
+	struct max17042_iio *iio;
+	int ret;
+
+	indio_dev = devm_iio_device_alloc(dev, sizeof(*iio));
+	if (!indio_dev)
+		return -ENOMEM;
+
+	iio = iio_priv(indio_dev);
+	iio->chip = chip;
+
+	indio_dev->name = chip->client->name;
+	indio_dev->info = &max17042_iio_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	if (chip->info->has_power) {
+		indio_dev->channels = max17055_iio_channels;
+		indio_dev->num_channels = ARRAY_SIZE(max17055_iio_channels);
+	} else {
+		indio_dev->channels = max17042_iio_channels;
+		indio_dev->num_channels = ARRAY_SIZE(max17042_iio_channels);
+	}
+
+	ret = devm_iio_triggered_buffer_setup(dev, indio_dev,
+					      iio_pollfunc_store_time,
+					      max17042_iio_trigger_handler,
+					      NULL);
+	if (ret)
+		return ret;
+
+	return devm_iio_device_register(dev, indio_dev);
+}
+#else
+static inline int max17042_iio_register(struct max17042_chip *chip)
+{
+	return 0;
+}
+#endif
+
+#if IS_REACHABLE(CONFIG_HWMON)
+static umode_t max17042_hwmon_is_visible(const void *data,
+					 enum hwmon_sensor_types type,
+					 u32 attr, int channel)
+{
+	const struct max17042_chip *chip = data;
+
+	switch (type) {
+	case hwmon_curr:
+		return chip->pdata->enable_current_sense ? 0444 : 0;
+	case hwmon_power:
+		return chip->info->has_power ? 0444 : 0;
+	default:
+		return 0444;
+	}
+}
+
+static int max17042_hwmon_read_in(struct max17042_chip *chip, u32 attr,
+				  long *val)
+{
+	u32 data;
+	int ret;
+
+	switch (attr) {
+	case hwmon_in_input:
+		ret = max17042_read_cached(chip, MAX17042_VCELL, &data);
+		break;
+	case hwmon_in_average:
+		ret = max17042_read_cached(chip, MAX17042_AvgVCELL, &data);
+		break;
+	case hwmon_in_lowest:
+	case hwmon_in_highest:
+		ret = max17042_read_cached(chip, MAX17042_MinMaxVolt, &data);
+		if (ret < 0)
+			return ret;
+		/* Units of LSB = 20mV, MSB is maximum */
+		if (attr == hwmon_in_highest)
+			*val = (data >> 8) * 20;
+		else
+			*val = (data & 0xff) * 20;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+	if (ret < 0)
+		return ret;
+
+	/* Units of LSB = 78.125 uV */
+	*val = data * 625 / 8000;
+	return 0;
+}
+
+static int max17042_hwmon_read_curr(struct max17042_chip *chip, u32 attr,
+				    long *val)
+{
+	u32 data;
+	int ret;
+
+	switch (attr) {
+	case hwmon_curr_input:
+		ret = max17042_read_cached(chip, MAX17042_Current, &data);
+		break;
+	case hwmon_curr_average:
+		ret = max17042_read_cached(chip, MAX17042_AvgCurrent, &data);
+		break;
+	case hwmon_curr_lowest:
+	case hwmon_curr_highest:
+		ret = max17042_read_cached(chip, MAX17042_MinMaxCurr, &data);
+		if (ret < 0)
+			return ret;
+		/* Signed bytes, units of LSB = 256 Current LSBs */
+		if (attr == hwmon_curr_highest)
+			data = sign_extend32(data >> 8, 7);
+		else
+			data = sign_extend32(data & 0xff, 7);
+		*val = max17042_scale(chip->current_scale, (s32)data * 256);
+		*val /= 1000;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+	if (ret < 0)
+		return ret;
+
+	*val = max17042_scale(chip->current_scale, sign_extend32(data, 15));
+	*val /= 1000;
+	return 0;
+}
+
+static int max17042_hwmon_read_temp(struct max17042_chip *chip, u32 attr,
+				    long *val)
+{
+	u32 data;
+	int ret;
+
+	switch (attr) {
+	case hwmon_temp_input:
+		ret = max17042_read_cached(chip, MAX17042_TEMP, &data);
+		break;
+	case hwmon_temp_lowest:
+	case hwmon_temp_highest:
+		ret = max17042_read_cached(chip, MAX17042_MinMaxTemp, &data);
+		if (ret < 0)
+			return ret;
+		/* Signed bytes in degrees Celsius, MSB is maximum */
+		if (attr == hwmon_temp_highest)
+			*val = sign_extend32(data >> 8, 7) * 1000;
+		else
+			*val = sign_extend32(data & 0xff, 7) * 1000;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+	if (ret < 0)
+		return ret;
+
+	/* Units of LSB = 1 / 256 degree Celsius */
+	*val = sign_extend32(data, 15) * 1000 / 256;
+	return 0;
+}
+
+static int max17042_hwmon_read_power(struct max17042_chip *chip, u32 attr,
+				     long *val)
+{
+	u32 data;
+	int ret;
+
+	switch (attr) {
+	case hwmon_power_input:
+		ret = max17042_read_cached(chip, MAX17055_POWER, &data);
+		break;
+	case hwmon_power_average:
+		ret = max17042_read_cached(chip, MAX17055_AvgPower, &data);
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+	if (ret < 0)
+		return ret;
+
+	*val = max17042_scale(chip->power_scale, sign_extend32(data, 15));
+	return 0;
+}
+
+static int max17042_hwmon_read(struct device *dev,
+			       enum hwmon_sensor_types type,
+			       u32 attr, int channel, long *val)
+{
+	struct max17042_chip *chip = dev_get_drvdata(dev);
+
+	if (!chip->init_complete)
+		return -EAGAIN;
+
+	switch (type) {
+	case hwmon_in:
+		return max17042_hwmon_read_in(chip, attr, val);
+	case hwmon_curr:
+		return max17042_hwmon_read_curr(chip, attr, val);
+	case hwmon_temp:
+		return max17042_hwmon_read_temp(chip, attr, val);
+	case hwmon_power:
+		return max17042_hwmon_read_power(chip, attr, val);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static const struct hwmon_channel_info * const max17042_hwmon_info[] = {
+	HWMON_CHANNEL_INFO(in, HWMON_I_INPUT | HWMON_I_AVERAGE |
+			   HWMON_I_LOWEST | HWMON_I_HIGHEST),
+	HWMON_CHANNEL_INFO(curr, HWMON_C_INPUT | HWMON_C_AVERAGE |
+			   HWMON_C_LOWEST | HWMON_C_HIGHEST),
+	HWMON_CHANNEL_INFO(power, HWMON_P_INPUT | HWMON_P_AVERAGE),
+	HWMON_CHANNEL_INFO(temp, HWMON_T_INPUT | HWMON_T_LOWEST |
+			   HWMON_T_HIGHEST),
+	NULL
+};
+
+static const struct hwmon_ops max17042_hwmon_ops = {
+	.is_visible = max17042_hwmon_is_visible,
+	.read = max17042_hwmon_read,
+};
+
+static const struct hwmon_chip_info max17042_hwmon_chip_info = {
+	.ops = &max17042_hwmon_ops,
+	.info = max17042_hwmon_info,
+};
+
+static int max17042_hwmon_register(struct max17042_chip *chip)
+{
+	struct device *hwmon;
+
+	hwmon = devm_hwmon_device_register_with_info(&chip->client->dev,
+						     "max17042", chip,
+						     &max17042_hwmon_chip_info,
+						     NULL);
+	return PTR_ERR_OR_ZERO(hwmon);
+}
+#else
+static inline int max17042_hwmon_register(struct max17042_chip *chip)
+{
+	return 0;
+}
+#endif
+
+static void max17042_account(struct max17042_chip *chip, u8 reg,
+			     size_t count, bool write, unsigned int xfers,
+			     u64 ns)
+{
+	struct max17042_bus_stats *stats = &chip->stats;
+	u32 us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (write)
+			stats->writes[(u8)(reg + i)]++;
+		else
+			stats->reads[(u8)(reg + i)]++;
+	}
+
+	if (us >> MAX17042_LAT_MIN_SHIFT)
+		bucket = min(ilog2(us) - MAX17042_LAT_MIN_SHIFT + 1,
+			     MAX17042_LAT_BUCKETS - 1);
+
+	stats->xfers += xfers;
+	stats->busy_ns += ns;
+	stats->max_ns = max(stats->max_ns, ns);
+	stats->lat_hist[bucket]++;
+}
+
+/*
+ * regmap bus kept local so that every bus transaction can be counted and
+ * timed. Bulk accesses use the cheapest path the adapter offers: a single
+ * combined write/read on plain I2C adapters, SMBus I2C-block transfers of
+ * up to 16 registers, or one SMBus word transfer per register.
+ */
+static int max17042_bus_read(void *context, const void *reg_buf,
+			     size_t reg_size, void *val_buf, size_t val_size)
+{
+	struct max17042_chip *chip = context;
+	struct i2c_client *client = chip->client;
+	u8 reg = *(const u8 *)reg_buf;
+	u64 start = ktime_get_ns();
+	unsigned int xfers = 0;
+	size_t i, len;
+	u64 ns;
+	int ret = 0;
+
+	if (chip->i2c_func & I2C_FUNC_I2C) {
+		struct i2c_msg xfer[2] = {
+			{
+				.addr = client->addr,
+				.len = reg_size,
+				.buf = (u8 *)reg_buf,
+			}, {
+				.addr = client->addr,
+				.flags = I2C_M_RD,
+				.len = val_size,
+				.buf = val_buf,
+			},
+		};
+
+		ret = i2c_transfer(client->adapter, xfer, ARRAY_SIZE(xfer));
+		if (ret >= 0)
+			ret = ret == ARRAY_SIZE(xfer) ? 0 : -EIO;
+		xfers++;
+	} else if (val_size > 2 &&
+		   (chip->i2c_func & I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+		for (i = 0; i < val_size; i += len) {
+			len = min_t(size_t, val_size - i, I2C_SMBUS_BLOCK_MAX);
+			ret = i2c_smbus_read_i2c_block_data(client, reg + i / 2,
+							    len, val_buf + i);
+			xfers++;
+			if (ret >= 0)
+				ret = ret == len ? 0 : -EIO;
+			if (ret < 0)
+				break;
+		}
+	} else {
+		for (i = 0; i < val_size / 2; i++) {
+			ret = i2c_smbus_read_word_data(client, reg + i);
+			xfers++;
+			if (ret < 0)
+				break;
+			put_unaligned_le16(ret, val_buf + 2 * i);
+			ret = 0;
+		}
+	}
+
+	ns = ktime_get_ns() - start;
+	max17042_account(chip, reg, val_size / 2, false, xfers, ns);
+	trace_max17042_reg_read(&client->dev, reg,
+				ret ? 0 : get_unaligned_le16(val_buf),
+				val_size / 2, ns, ret);
+	return ret;
+}
+
+static int max17042_bus_write(void *context, const void *data, size_t count)
+{
+	struct max17042_chip *chip = context;
+	struct i2c_client *client = chip->client;
+	const u8 *buf = data;
+	size_t val_size = count - 1;
+	u64 start = ktime_get_ns();
+	unsigned int xfers = 0;
+	size_t i, len;
+	u64 ns;
+	int ret = 0;
+
+	if (chip->i2c_func & I2C_FUNC_I2C) {
+		ret = i2c_master_send(client, data, count);
+		if (ret >= 0)
+			ret = ret == count ? 0 : -EIO;
+		xfers++;
+	} else if (val_size > 2 &&
+		   (chip->i2c_func & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK)) {
+		for (i = 0; i < val_size; i += len) {
+			len = min_t(size_t, val_size - i, I2C_SMBUS_BLOCK_MAX);
+			ret = i2c_smbus_write_i2c_block_data(client,
+							     buf[0] + i / 2,
+							     len, buf + 1 + i);
+			xfers++;
+			if (ret < 0)
+				break;
+		}
+	} else {
+		for (i = 0; i < val_size / 2; i++) {
+			ret = i2c_smbus_write_word_data(client, buf[0] + i,
+					get_unaligned_le16(buf + 1 + 2 * i));
+			xfers++;
+			if (ret < 0)
+				break;
+		}
+	}
+
+	ns = ktime_get_ns() - start;
+	max17042_account(chip, buf[0], val_size / 2, true, xfers, ns);
+	trace_max17042_reg_write(&client->dev, buf[0],
+				 get_unaligned_le16(buf + 1), val_size / 2,
+				 ns, ret);
+	return ret;
+}
+
+static const struct regmap_bus max17042_regmap_bus = {
+	.read = max17042_bus_read,
+	.write = max17042_bus_write,
+};
+
 static const struct regmap_config max17042_regmap_config = {
 	.reg_bits = 8,
 	.val_bits = 16,
-	.val_format_endian = REGMAP_ENDIAN_NATIVE,
+	/* Registers are LSB first on the wire */
+	.val_format_endian = REGMAP_ENDIAN_LITTLE,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static int max17042_stats_show(struct seq_file *s, void *unused)
+{
+	struct max17042_chip *chip = s->private;
+	struct max17042_bus_stats *stats = &chip->stats;
+	int i;
+
+	seq_printf(s, "transfers: %llu\n", stats->xfers);
+	seq_printf(s, "busy_ns: %llu\n", stats->busy_ns);
+	seq_printf(s, "max_ns: %llu\n", stats->max_ns);
+
+	seq_puts(s, "latency_us:");
+	for (i = 0; i < MAX17042_LAT_BUCKETS - 1; i++)
+		seq_printf(s, " <%u:%u",
+			   1U << (i + MAX17042_LAT_MIN_SHIFT), stats->lat_hist[i]);
+	seq_printf(s, " >=%u:%u\n", 1U << (i + MAX17042_LAT_MIN_SHIFT - 1),
+		   stats->lat_hist[i]);
+
+	seq_printf(s, "irqs: %u\n", stats->irqs);
+	for (i = 0; i < ARRAY_SIZE(stats->irq_status); i++)
+		if (stats->irq_status[i])
+			seq_printf(s, "irq_status_bit%d: %u\n", i,
+				   stats->irq_status[i]);
+
+	seq_printf(s, "notify_sent: %u\n", stats->notify_sent);
+	seq_printf(s, "notify_suppressed: %u\n", stats->notify_suppressed);
+	seq_printf(s, "notify_deferred: %u\n", stats->notify_deferred);
+
+	seq_puts(s, "reg reads writes\n");
+	for (i = 0; i < ARRAY_SIZE(stats->reads); i++)
+		if (stats->reads[i] || stats->writes[i])
+			seq_printf(s, "0x%02x %u %u\n", i, stats->reads[i],
+				   stats->writes[i]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max17042_stats);
+
+#define MAX17042_DUMP_CHUNK	16
+
+static int max17042_registers_show(struct seq_file *s, void *unused)
+{
+	struct max17042_chip *chip = s->private;
+	u16 buf[MAX17042_DUMP_CHUNK];
+	int reg, i, ret;
+
+	for (reg = 0; reg <= 0xff; reg += MAX17042_DUMP_CHUNK) {
+		ret = regmap_bulk_read(chip->regmap, reg, buf, ARRAY_SIZE(buf));
+		if (ret < 0)
+			return ret;
+
+		seq_printf(s, "%02x:", reg);
+		for (i = 0; i < ARRAY_SIZE(buf); i++)
+			seq_printf(s, " %04x", buf[i]);
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max17042_registers);
+
+static void max17042_debugfs_init(struct max17042_chip *chip)
+{
+	struct dentry *root = chip->client->debugfs;
+
+	debugfs_create_file("stats", 0444, root, chip, &max17042_stats_fops);
+	debugfs_create_file("registers", 0400, root, chip,
+			    &max17042_registers_fops);
+}
+#else
+static inline void max17042_debugfs_init(struct max17042_chip *chip)
+{
+}
+#endif
+
+static ssize_t learned_params_read(struct file *filp, struct kobject *kobj,
+				   struct bin_attribute *attr, char *buf,
+				   loff_t off, size_t count)
+{
+	struct power_supply *psy = to_power_supply(kobj_to_dev(kobj));
+	struct max17042_chip *chip = power_supply_get_drvdata(psy);
+	struct max17042_learned learned;
+	int ret;
+
+	if (!chip->init_complete)
+		return -EAGAIN;
+
+	ret = max17042_learned_save(chip, &learned);
+	if (ret < 0)
+		return ret;
+
+	return memory_read_from_buffer(buf, count, &off, &learned,
+				       sizeof(learned));
+}
+
+static ssize_t learned_params_write(struct file *filp, struct kobject *kobj,
+				    struct bin_attribute *attr, char *buf,
+				    loff_t off, size_t count)
+{
+	struct power_supply *psy = to_power_supply(kobj_to_dev(kobj));
+	struct max17042_chip *chip = power_supply_get_drvdata(psy);
+	int ret;
+
+	if (off)
+		return -EINVAL;
+
+	ret = max17042_learned_validate(chip, buf, count);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&chip->learned_lock);
+	memcpy(&chip->learned, buf, sizeof(chip->learned));
+	chip->have_learned = true;
+	if (chip->init_complete)
+		max17042_learned_restore(chip);
+	mutex_unlock(&chip->learned_lock);
+
+	if (chip->learned_cell) {
+		ret = nvmem_cell_write(chip->learned_cell, buf, count);
+		if (ret < 0)
+			dev_warn(&chip->client->dev,
+				 "failed to store learned params: %d\n", ret);
+	}
+
+	return count;
+}
+static BIN_ATTR_RW(learned_params, sizeof(struct max17042_learned));
+
+static ssize_t max17055_show_peak(struct device *dev, char *buf, u8 reg)
+{
+	struct max17042_chip *chip =
+		power_supply_get_drvdata(to_power_supply(dev));
+	u32 data;
+	int ret;
+
+	ret = max17042_read_cached(chip, reg, &data);
+	if (ret < 0)
+		return ret;
+
+	/* Same LSB as Power, in uW */
+	return sysfs_emit(buf, "%d\n", max17042_scale(chip->power_scale,
+						      sign_extend32(data, 15)));
+}
+
+static ssize_t max_peak_power_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return max17055_show_peak(dev, buf, MAX17055_MaxPeakPwr);
+}
+static DEVICE_ATTR_RO(max_peak_power);
+
+static ssize_t sustained_peak_power_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	return max17055_show_peak(dev, buf, MAX17055_SusPeakPwr);
+}
+static DEVICE_ATTR_RO(sustained_peak_power);
+
+static ssize_t cell_resistance_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct max17042_chip *chip =
+		power_supply_get_drvdata(to_power_supply(dev));
+	u32 data;
+	int ret;
+
+	ret = max17042_read_cached(chip, MAX17055_RCell, &data);
+	if (ret < 0)
+		return ret;
+
+	/* RCell LSB is 1/4096 Ohm, report micro-Ohms */
+	return sysfs_emit(buf, "%u\n", data * 15625 / 64);
+}
+static DEVICE_ATTR_RO(cell_resistance);
+
+static struct attribute *max17042_attrs[] = {
+	&dev_attr_max_peak_power.attr,
+	&dev_attr_sustained_peak_power.attr,
+	&dev_attr_cell_resistance.attr,
+	NULL,
+};
+
+static umode_t max17042_attr_is_visible(struct kobject *kobj,
+					struct attribute *attr, int n)
+{
+	struct power_supply *psy = to_power_supply(kobj_to_dev(kobj));
+	struct max17042_chip *chip = power_supply_get_drvdata(psy);
+
+	/* The peak power and cell resistance estimates are MAX17055 only */
+	if (!chip->info->has_power || !chip->pdata->enable_current_sense)
+		return 0;
+
+	return attr->mode;
+}
+
+static struct bin_attribute *max17042_bin_attrs[] = {
+	&bin_attr_learned_params,
+	NULL,
+};
+
+static const struct attribute_group max17042_attr_group = {
+	.attrs = max17042_attrs,
+	.is_visible = max17042_attr_is_visible,
+	.bin_attrs = max17042_bin_attrs,
+};
+
+static const struct attribute_group *max17042_attr_groups[] = {
+	&max17042_attr_group,
+	NULL,
 };
 
+/* Pick up learned parameters saved by a previous boot, if any */
+static int max17042_learned_load(struct max17042_chip *chip)
+{
+	struct device *dev = &chip->client->dev;
+	struct nvmem_cell *cell;
+	size_t len;
+	void *buf;
+
+	cell = devm_nvmem_cell_get(dev, "learned-params");
+	if (IS_ERR(cell)) {
+		if (PTR_ERR(cell) == -EPROBE_DEFER)
+			return -EPROBE_DEFER;
+		return 0;
+	}
+	chip->learned_cell = cell;
+
+	buf = nvmem_cell_read(cell, &len);
+	if (IS_ERR(buf))
+		return 0;
+
+	if (!max17042_learned_validate(chip, buf, len)) {
+		memcpy(&chip->learned, buf, sizeof(chip->learned));
+		chip->have_learned = true;
+	} else {
+		dev_info(dev, "ignoring invalid learned params\n");
+	}
+	kfree(buf);
+
+	return 0;
+}
+
 static const struct power_supply_desc max17042_psy_desc = {
 	.name		= "max170xx_battery",
 	.type		= POWER_SUPPLY_TYPE_BATTERY,
 	.get_property	= max17042_get_property,
 	.set_property	= max17042_set_property,
 	.property_is_writeable	= max17042_property_is_writeable,
-	.external_power_changed	= power_supply_changed,
+	.external_power_changed	= max17042_external_power_changed,
 	.properties	= max17042_battery_props,
 	.num_properties	= ARRAY_SIZE(max17042_battery_props),
 };
@@ -1026,11 +2525,132 @@ static const struct power_supply_desc max17042_no_current_sense_psy_desc = {
 	.num_properties	= ARRAY_SIZE(max17042_battery_props) - 2,
 };
 
+static const struct power_supply_desc max17055_psy_desc = {
+	.name		= "max170xx_battery",
+	.type		= POWER_SUPPLY_TYPE_BATTERY,
+	.get_property	= max17042_get_property,
+	.set_property	= max17042_set_property,
+	.property_is_writeable	= max17042_property_is_writeable,
+	.external_power_changed	= max17042_external_power_changed,
+	.properties	= max17055_battery_props,
+	.num_properties	= ARRAY_SIZE(max17055_battery_props),
+};
+
+static const struct power_supply_desc max17055_no_current_sense_psy_desc = {
+	.name		= "max170xx_battery",
+	.type		= POWER_SUPPLY_TYPE_BATTERY,
+	.get_property	= max17042_get_property,
+	.set_property	= max17042_set_property,
+	.property_is_writeable	= max17042_property_is_writeable,
+	.properties	= max17055_battery_props,
+	.num_properties	= ARRAY_SIZE(max17055_battery_props) - 5,
+};
+
+#define MAX17042_POR_REG(_reg, _member)					\
+	{ _reg, offsetof(struct max17042_config_data, _member) }
+
+#define MAX17042_POR_COMMON_REGS					\
+	MAX17042_POR_REG(MAX17042_TGAIN, tgain),			\
+	MAX17042_POR_REG(MAX17042_TOFF, toff),				\
+	MAX17042_POR_REG(MAX17042_CGAIN, cgain),			\
+	MAX17042_POR_REG(MAX17042_COFF, coff),				\
+	MAX17042_POR_REG(MAX17042_VALRT_Th, valrt_thresh),		\
+	MAX17042_POR_REG(MAX17042_TALRT_Th, talrt_thresh),		\
+	MAX17042_POR_REG(MAX17042_SALRT_Th, soc_alrt_thresh),		\
+	MAX17042_POR_REG(MAX17042_CONFIG, config),			\
+	MAX17042_POR_REG(MAX17042_SHDNTIMER, shdntimer),		\
+	MAX17042_POR_REG(MAX17042_DesignCap, design_cap),		\
+	MAX17042_POR_REG(MAX17042_ICHGTerm, ichgt_term),		\
+	MAX17042_POR_REG(MAX17042_AtRate, at_rate),			\
+	MAX17042_POR_REG(MAX17042_LearnCFG, learn_cfg),		\
+	MAX17042_POR_REG(MAX17042_FilterCFG, filter_cfg),		\
+	MAX17042_POR_REG(MAX17042_RelaxCFG, relax_cfg),		\
+	MAX17042_POR_REG(MAX17042_MiscCFG, misc_cfg),			\
+	MAX17042_POR_REG(MAX17042_FullCAP, fullcap),			\
+	MAX17042_POR_REG(MAX17042_FullCAPNom, fullcapnom),		\
+	MAX17042_POR_REG(MAX17042_dQacc, dqacc),			\
+	MAX17042_POR_REG(MAX17042_dPacc, dpacc),			\
+	MAX17042_POR_REG(MAX17042_RCOMP0, rcomp0),			\
+	MAX17042_POR_REG(MAX17042_TempCo, tcompc0)
+
+#define MAX17042_POR_TEMP_REGS						\
+	MAX17042_POR_REG(MAX17042_IAvg_empty, iavg_empty),		\
+	MAX17042_POR_REG(MAX17042_TempNom, temp_nom),			\
+	MAX17042_POR_REG(MAX17042_TempLim, temp_lim),			\
+	MAX17042_POR_REG(MAX17042_FCTC, fctc)
+
+static const struct max17042_por_reg max17042_por_regs[] = {
+	MAX17042_POR_COMMON_REGS,
+	MAX17042_POR_REG(MAX17042_MaskSOC, masksoc),
+	MAX17042_POR_REG(MAX17042_SOC_empty, socempty),
+	MAX17042_POR_REG(MAX17042_V_empty, vempty),
+	MAX17042_POR_REG(MAX17042_EmptyTempCo, empty_tempco),
+	MAX17042_POR_REG(MAX17042_K_empty0, kempty0),
+	MAX17042_POR_TEMP_REGS,
+};
+
+static const struct max17042_por_reg max17047_por_regs[] = {
+	MAX17042_POR_COMMON_REGS,
+	MAX17042_POR_TEMP_REGS,
+	MAX17042_POR_REG(MAX17047_V_empty, vempty),
+};
+
+static const struct max17042_por_reg max17055_por_regs[] = {
+	MAX17042_POR_COMMON_REGS,
+	MAX17042_POR_REG(MAX17047_V_empty, vempty),
+};
+
+static const struct max17042_chip_info max17042_chip_info[] = {
+	[MAXIM_DEVICE_TYPE_MAX17042] = {
+		.vempty_reg = MAX17042_V_empty,
+		.por_regs = max17042_por_regs,
+		.num_por_regs = ARRAY_SIZE(max17042_por_regs),
+		.psy_desc = &max17042_psy_desc,
+		.psy_desc_no_current_sense = &max17042_no_current_sense_psy_desc,
+	},
+	[MAXIM_DEVICE_TYPE_MAX17047] = {
+		.vempty_reg = MAX17047_V_empty,
+		.has_full_soc_thr = true,
+		.has_qrtbl = true,
+		.por_regs = max17047_por_regs,
+		.num_por_regs = ARRAY_SIZE(max17047_por_regs),
+		.default_init_regs = max17047_default_pdata_init_regs,
+		.num_default_init_regs =
+			ARRAY_SIZE(max17047_default_pdata_init_regs),
+		.psy_desc = &max17042_psy_desc,
+		.psy_desc_no_current_sense = &max17042_no_current_sense_psy_desc,
+	},
+	[MAXIM_DEVICE_TYPE_MAX17050] = {
+		.vempty_reg = MAX17047_V_empty,
+		.has_full_soc_thr = true,
+		.has_qrtbl = true,
+		.por_regs = max17047_por_regs,
+		.num_por_regs = ARRAY_SIZE(max17047_por_regs),
+		.default_init_regs = max17047_default_pdata_init_regs,
+		.num_default_init_regs =
+			ARRAY_SIZE(max17047_default_pdata_init_regs),
+		.psy_desc = &max17042_psy_desc,
+		.psy_desc_no_current_sense = &max17042_no_current_sense_psy_desc,
+	},
+	[MAXIM_DEVICE_TYPE_MAX17055] = {
+		.vempty_reg = MAX17047_V_empty,
+		.has_full_soc_thr = true,
+		.has_qrtbl = true,
+		.has_power = true,
+		.has_dsoc_alert = true,
+		.has_ez_config = true,
+		.por_regs = max17055_por_regs,
+		.num_por_regs = ARRAY_SIZE(max17055_por_regs),
+		.psy_desc = &max17055_psy_desc,
+		.psy_desc_no_current_sense = &max17055_no_current_sense_psy_desc,
+	},
+};
+
 static int max17042_probe(struct i2c_client *client)
 {
 	const struct i2c_device_id *id = i2c_client_get_device_id(client);
 	struct i2c_adapter *adapter = client->adapter;
-	const struct power_supply_desc *max17042_desc = &max17042_psy_desc;
+	const struct power_supply_desc *max17042_desc;
 	struct power_supply_config psy_cfg = {};
 	const struct acpi_device_id *acpi_id = NULL;
 	struct device *dev = &client->dev;
@@ -1039,7 +2659,8 @@ static int max17042_probe(struct i2c_client *client)
 	int i;
 	u32 val;
 
-	if (!i2c_check_functionality(adapter, I2C_FUNC_SMBUS_WORD_DATA))
+	if (!i2c_check_functionality(adapter, I2C_FUNC_SMBUS_WORD_DATA) &&
+	    !i2c_check_functionality(adapter, I2C_FUNC_I2C))
 		return -EIO;
 
 	chip = devm_kzalloc(&client->dev, sizeof(*chip), GFP_KERNEL);
@@ -1056,7 +2677,14 @@ static int max17042_probe(struct i2c_client *client)
 
 		chip->chip_type = acpi_id->driver_data;
 	}
-	chip->regmap = devm_regmap_init_i2c(client, &max17042_regmap_config);
+	if (chip->chip_type <= MAXIM_DEVICE_TYPE_UNKNOWN ||
+	    chip->chip_type >= MAXIM_DEVICE_TYPE_NUM)
+		return -ENODEV;
+	chip->info = &max17042_chip_info[chip->chip_type];
+
+	chip->i2c_func = i2c_get_functionality(adapter);
+	chip->regmap = devm_regmap_init(&client->dev, &max17042_regmap_bus,
+					chip, &max17042_regmap_config);
 	if (IS_ERR(chip->regmap)) {
 		dev_err(&client->dev, "Failed to initialize regmap\n");
 		return -EINVAL;
@@ -1068,18 +2696,31 @@ static int max17042_probe(struct i2c_client *client)
 		return -EINVAL;
 	}
 
+	mutex_init(&chip->learned_lock);
+	mutex_init(&chip->notify_lock);
+	chip->notify_last = jiffies -
+			    msecs_to_jiffies(chip->pdata->notify_min_interval_ms);
+	ret = max17042_learned_load(chip);
+	if (ret)
+		return ret;
+
 	i2c_set_clientdata(client, chip);
 	psy_cfg.drv_data = chip;
 	psy_cfg.of_node = dev->of_node;
+	psy_cfg.attr_grp = max17042_attr_groups;
 
 	/* When current is not measured,
 	 * CURRENT_NOW and CURRENT_AVG properties should be invisible. */
-	if (!chip->pdata->enable_current_sense)
-		max17042_desc = &max17042_no_current_sense_psy_desc;
+	if (chip->pdata->enable_current_sense)
+		max17042_desc = chip->info->psy_desc;
+	else
+		max17042_desc = chip->info->psy_desc_no_current_sense;
 
 	if (chip->pdata->r_sns == 0)
 		chip->pdata->r_sns = MAX17042_DEFAULT_SNS_RESISTOR;
 
+	max17042_init_scales(chip);
+
 	if (chip->pdata->init_data)
 		for (i = 0; i < chip->pdata->num_init_data; i++)
 			regmap_write(chip->regmap,
@@ -1099,6 +2740,37 @@ static int max17042_probe(struct i2c_client *client)
 		return PTR_ERR(chip->battery);
 	}
 
+	ret = max17042_get_battery_config(chip);
+	if (ret)
+		return ret;
+
+	ret = devm_delayed_work_autocancel(&client->dev, &chip->notify_work,
+					   max17042_notify_worker);
+	if (ret)
+		return ret;
+
+	seqlock_init(&chip->snap_lock);
+	ret = devm_delayed_work_autocancel(&client->dev, &chip->snap_work,
+					   max17042_snapshot_worker);
+	if (ret)
+		return ret;
+	if (chip->pdata->snapshot_interval_ms)
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				   &chip->snap_work, 0);
+
+	max17042_debugfs_init(chip);
+
+	/* The IIO capture device is optional, the battery works without it */
+	ret = max17042_iio_register(chip);
+	if (ret)
+		dev_warn(&client->dev, "failed to register IIO device: %d\n",
+			 ret);
+
+	ret = max17042_hwmon_register(chip);
+	if (ret)
+		dev_warn(&client->dev, "failed to register hwmon device: %d\n",
+			 ret);
+
 	if (client->irq) {
 		unsigned int flags = IRQF_ONESHOT;
 
@@ -1115,10 +2787,7 @@ static int max17042_probe(struct i2c_client *client)
 						chip->battery->desc->name,
 						chip);
 		if (!ret) {
-			regmap_update_bits(chip->regmap, MAX17042_CONFIG,
-					CONFIG_ALRT_BIT_ENBL,
-					CONFIG_ALRT_BIT_ENBL);
-			max17042_set_soc_threshold(chip, 1);
+			max17042_arm_alerts(chip);
 		} else {
 			client->irq = 0;
 			if (ret != -EBUSY)
@@ -1129,12 +2798,14 @@ static int max17042_probe(struct i2c_client *client)
 	if (!client->irq)
 		regmap_write(chip->regmap, MAX17042_SALRT_Th, 0xff00);
 
+	/* Also needed when a POR is only noticed at resume time */
+	ret = devm_work_autocancel(&client->dev, &chip->work,
+				   max17042_init_worker);
+	if (ret)
+		return ret;
+
 	regmap_read(chip->regmap, MAX17042_STATUS, &val);
 	if (val & STATUS_POR_BIT) {
-		ret = devm_work_autocancel(&client->dev, &chip->work,
-					   max17042_init_worker);
-		if (ret)
-			return ret;
 		schedule_work(&chip->work);
 	} else {
 		chip->init_complete = 1;
@@ -1160,15 +2831,69 @@ static int max17042_suspend(struct device *dev)
 	return 0;
 }
 
+/*
+ * Read what resume needs: STATUS to tell whether the gauge lost its
+ * configuration, plus SALRT_Th and RepSOC when the SOC alert window has to
+ * follow the SOC. All three sit in STATUS .. RepSOC, which is read in one
+ * go. With the snapshot enabled and an adapter that moves the whole
+ * STATUS .. TTF window in one or three transfers, read the window instead
+ * so the snapshot is fresh too; on word-only adapters that would cost 33
+ * transfers.
+ */
+static int max17042_resume_read(struct max17042_chip *chip, u16 *regs,
+				bool full)
+{
+	return regmap_bulk_read(chip->regmap, MAX17042_STATUS, regs,
+				full ? MAX17042_SNAP_LO_REGS :
+				       MAX17042_RepSOC + 1);
+}
+
+/*
+ * Resume with as few transfers as possible, see max17042_resume_read().
+ * The remaining snapshot registers follow with the next snapshot worker
+ * run, and a re-init after POR runs in the background.
+ */
 static int max17042_resume(struct device *dev)
 {
 	struct max17042_chip *chip = dev_get_drvdata(dev);
+	u16 regs[MAX17042_SNAP_LO_REGS] = { };
+	u32 soc_tr;
+	bool full;
+	int ret;
 
 	if (chip->client->irq) {
 		disable_irq_wake(chip->client->irq);
 		enable_irq(chip->client->irq);
-		/* re-program the SOC thresholds to 1% change */
-		max17042_set_soc_threshold(chip, 1);
+	}
+
+	full = chip->pdata->snapshot_interval_ms &&
+	       (chip->i2c_func & (I2C_FUNC_I2C |
+				  I2C_FUNC_SMBUS_READ_I2C_BLOCK));
+	ret = max17042_resume_read(chip, regs, full);
+	if (ret) {
+		dev_warn(dev, "resume: failed to read gauge: %d\n", ret);
+		return 0;
+	}
+
+	if (full) {
+		write_seqlock(&chip->snap_lock);
+		if (chip->snap.valid)
+			memcpy(chip->snap.regs, regs, sizeof(regs));
+		write_sequnlock(&chip->snap_lock);
+	}
+
+	if (regs[MAX17042_STATUS] & STATUS_POR_BIT) {
+		dev_info(dev, "gauge reset while suspended, reinitializing\n");
+		chip->init_complete = 0;
+		schedule_work(&chip->work);
+		return 0;
+	}
+
+	/* re-program the SOC thresholds to 1% change, if SOC moved */
+	if (chip->client->irq && !chip->dsoc_alert) {
+		soc_tr = max17042_soc_window(regs[MAX17042_RepSOC] >> 8, 1);
+		if (regs[MAX17042_SALRT_Th] != soc_tr)
+			regmap_write(chip->regmap, MAX17042_SALRT_Th, soc_tr);
 	}
 
 	return 0;
@@ -1223,3 +2948,7 @@ module_i2c_driver(max17042_i2c_driver);
 MODULE_AUTHOR("MyungJoo Ham <myungjoo.ham@samsung.com>");
 MODULE_DESCRIPTION("MAX17042 Fuel Gauge");
 MODULE_LICENSE("GPL");
+
+#if IS_ENABLED(CONFIG_BATTERY_MAX17042_KUNIT_TEST)
+#include "max17042_battery_kunit.c"
+#endif
@@ -17,6 +17,7 @@
 #define MAX17042_DEFAULT_VMAX		(4500) /* LiHV cell max */
 #define MAX17042_DEFAULT_TEMP_MIN	(0)    /* For sys without temp sensor */
 #define MAX17042_DEFAULT_TEMP_MAX	(700)  /* 70 degrees Celcius */
+#define MAX17042_DEFAULT_SNAPSHOT_INTERVAL	(0)    /* ms, opt-in: polls the bus */
 
 /* Consider RepCap which is less then 10 units below FullCAP full */
 #define MAX17042_FULL_THRESHOLD		10
@@ -122,6 +123,8 @@ enum max17055_register {
 	MAX17055_ConvgCfg	= 0x49,
 	MAX17055_VFRemCap	= 0x4A,
 
+	MAX17055_Command	= 0x60,
+
 	MAX17055_STATUS2	= 0xB0,
 	MAX17055_POWER		= 0xB1,
 	MAX17055_ID		= 0xB2,
@@ -245,7 +248,7 @@ struct max17042_config_data {
 } __packed;
 
 struct max17042_platform_data {
-	struct max17042_reg_data *init_data;
+	const struct max17042_reg_data *init_data;
 	struct max17042_config_data *config_data;
 	int num_init_data; /* Number of enties in init_data array */
 	bool enable_current_sense;
@@ -261,6 +264,29 @@ struct max17042_platform_data {
 	int         vmax;	/* in millivolts */
 	int         temp_min;	/* in tenths of degree Celsius */
 	int         temp_max;	/* in tenths of degree Celsius */
+
+	/*
+	 * Window in milliseconds over which alert interrupts are merged into
+	 * a single power_supply_changed notification. 0 notifies immediately.
+	 */
+	unsigned int alert_coalesce_ms;
+
+	/*
+	 * Notification filtering. power_supply_changed is sent at most once
+	 * per notify_min_interval_ms, and only when SOC (in percent), VCELL
+	 * (in millivolts) or AvgCurrent (in milliamps) moved by at least the
+	 * matching delta since the last one. 0 disables a limit.
+	 */
+	unsigned int notify_min_interval_ms;
+	unsigned int notify_delta_soc;
+	unsigned int notify_delta_mv;
+	unsigned int notify_delta_ma;
+
+	/*
+	 * Period in milliseconds of the cached register snapshot that
+	 * property reads are served from. 0 reads the chip on every access.
+	 */
+	unsigned int snapshot_interval_ms;
 };
 
 #endif /* __MAX17042_BATTERY_H_ */
@@ -0,0 +1,826 @@
+// SPDX-License-Identifier: GPL-2.0+
+//
+// KUnit tests for the max17042_battery driver
+//
+// Built into the driver, see CONFIG_BATTERY_MAX17042_KUNIT_TEST, so that
+// the static bus, snapshot and init helpers can be tested without hardware.
+
+#include <kunit/test.h>
+
+#define MAX17042_TEST_ADDR	0x36
+
+/*
+ * Register file of the emulated gauge, reachable through an I2C adapter
+ * that offers plain I2C, SMBus word and SMBus I2C-block transfers. The
+ * driver picks the path from chip->i2c_func, the adapter counts what
+ * actually went over the wire.
+ */
+struct max17042_test {
+	struct i2c_adapter adap;
+	struct i2c_client *client;
+	struct max17042_chip chip;
+	struct max17042_platform_data pdata;
+	u16 regs[256];
+	unsigned int i2c_xfers;
+	unsigned int word_xfers;
+	unsigned int block_xfers;
+	bool short_block;	/* I2C-block reads return one byte less */
+};
+
+/* Registers are little endian and auto-increment, like on the chip */
+static u8 max17042_test_get_byte(struct max17042_test *t, u8 reg, int i)
+{
+	u16 val = t->regs[(u8)(reg + i / 2)];
+
+	return i & 1 ? val >> 8 : val & 0xff;
+}
+
+static void max17042_test_set_byte(struct max17042_test *t, u8 reg, int i,
+				   u8 byte)
+{
+	u16 *val = &t->regs[(u8)(reg + i / 2)];
+
+	if (i & 1)
+		*val = (*val & 0x00ff) | byte << 8;
+	else
+		*val = (*val & 0xff00) | byte;
+}
+
+static int max17042_test_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
+			      int num)
+{
+	struct max17042_test *t = i2c_get_adapdata(adap);
+	u8 reg;
+	int i;
+
+	t->i2c_xfers++;
+	if (num < 1 || num > 2 || (msgs[0].flags & I2C_M_RD) || !msgs[0].len)
+		return -EIO;
+	if (num == 2 && !(msgs[1].flags & I2C_M_RD))
+		return -EIO;
+
+	reg = msgs[0].buf[0];
+	for (i = 1; i < msgs[0].len; i++)
+		max17042_test_set_byte(t, reg, i - 1, msgs[0].buf[i]);
+	if (num == 2)
+		for (i = 0; i < msgs[1].len; i++)
+			msgs[1].buf[i] = max17042_test_get_byte(t, reg, i);
+
+	return num;
+}
+
+/* -EIO rather than -EOPNOTSUPP, the core must not emulate a missing path */
+static int max17042_test_smbus_xfer(struct i2c_adapter *adap, u16 addr,
+				    unsigned short flags, char read_write,
+				    u8 command, int size,
+				    union i2c_smbus_data *data)
+{
+	struct max17042_test *t = i2c_get_adapdata(adap);
+	int i, len;
+
+	switch (size) {
+	case I2C_SMBUS_WORD_DATA:
+		t->word_xfers++;
+		if (read_write == I2C_SMBUS_READ)
+			data->word = t->regs[command];
+		else
+			t->regs[command] = data->word;
+		return 0;
+	case I2C_SMBUS_I2C_BLOCK_DATA:
+		t->block_xfers++;
+		len = data->block[0];
+		if (read_write == I2C_SMBUS_WRITE) {
+			for (i = 0; i < len; i++)
+				max17042_test_set_byte(t, command, i,
+						       data->block[i + 1]);
+			return 0;
+		}
+		if (t->short_block)
+			data->block[0] = --len;
+		for (i = 0; i < len; i++)
+			data->block[i + 1] = max17042_test_get_byte(t, command, i);
+		return 0;
+	default:
+		return -EIO;
+	}
+}
+
+static u32 max17042_test_functionality(struct i2c_adapter *adap)
+{
+	return I2C_FUNC_I2C | I2C_FUNC_SMBUS_WORD_DATA |
+	       I2C_FUNC_SMBUS_I2C_BLOCK;
+}
+
+static const struct i2c_algorithm max17042_test_algo = {
+	.master_xfer = max17042_test_xfer,
+	.smbus_xfer = max17042_test_smbus_xfer,
+	.functionality = max17042_test_functionality,
+};
+
+/* bus gets the chip as context, like the driver's own regmap bus */
+static int max17042_test_setup(struct kunit *test,
+			       enum max170xx_chip_type type,
+			       const struct regmap_bus *bus)
+{
+	struct max17042_test *t;
+	struct max17042_chip *chip;
+	int ret, i;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+	test->priv = t;
+	INIT_DELAYED_WORK(&t->chip.notify_work, max17042_notify_worker);
+
+	t->adap.owner = THIS_MODULE;
+	t->adap.algo = &max17042_test_algo;
+	strscpy(t->adap.name, "max17042-kunit", sizeof(t->adap.name));
+	i2c_set_adapdata(&t->adap, t);
+	ret = i2c_add_adapter(&t->adap);
+	if (ret) {
+		t->adap.algo = NULL;
+		return ret;
+	}
+
+	t->client = i2c_new_dummy_device(&t->adap, MAX17042_TEST_ADDR);
+	if (IS_ERR(t->client)) {
+		ret = PTR_ERR(t->client);
+		t->client = NULL;
+		return ret;
+	}
+
+	/* A distinct value per register shows which one was transferred */
+	for (i = 0; i < ARRAY_SIZE(t->regs); i++)
+		t->regs[i] = i << 8 | (~i & 0xff);
+
+	chip = &t->chip;
+	chip->client = t->client;
+	chip->chip_type = type;
+	chip->info = &max17042_chip_info[type];
+	chip->pdata = &t->pdata;
+	chip->i2c_func = max17042_test_functionality(&t->adap);
+	chip->regmap = regmap_init(&t->client->dev, bus, chip,
+				   &max17042_regmap_config);
+	if (IS_ERR(chip->regmap)) {
+		ret = PTR_ERR(chip->regmap);
+		chip->regmap = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+static void max17042_test_exit(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	if (!t)
+		return;
+	cancel_delayed_work_sync(&t->chip.notify_work);
+	if (t->chip.regmap)
+		regmap_exit(t->chip.regmap);
+	if (t->client)
+		i2c_unregister_device(t->client);
+	if (t->adap.algo)
+		i2c_del_adapter(&t->adap);
+}
+
+static unsigned int max17042_test_wire_xfers(struct max17042_test *t)
+{
+	return t->i2c_xfers + t->word_xfers + t->block_xfers;
+}
+
+static int max17042_bus_test_init(struct kunit *test)
+{
+	return max17042_test_setup(test, MAXIM_DEVICE_TYPE_MAX17055,
+				   &max17042_regmap_bus);
+}
+
+/* Read count registers from reg, check data and the transfers it took */
+static void max17042_bus_test_read(struct kunit *test, u32 func, u8 reg,
+				   int count, unsigned int i2c,
+				   unsigned int blocks, unsigned int words)
+{
+	struct max17042_test *t = test->priv;
+	u16 *buf;
+	int i;
+
+	buf = kunit_kcalloc(test, count, sizeof(*buf), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+
+	t->chip.i2c_func = func;
+	KUNIT_ASSERT_EQ(test, regmap_bulk_read(t->chip.regmap, reg, buf,
+					       count), 0);
+
+	for (i = 0; i < count; i++)
+		KUNIT_EXPECT_EQ_MSG(test, buf[i], t->regs[reg + i],
+				    "register 0x%02x", reg + i);
+
+	KUNIT_EXPECT_EQ(test, t->i2c_xfers, i2c);
+	KUNIT_EXPECT_EQ(test, t->block_xfers, blocks);
+	KUNIT_EXPECT_EQ(test, t->word_xfers, words);
+	/* The driver's own accounting must agree with the wire */
+	KUNIT_EXPECT_EQ(test, t->chip.stats.xfers,
+			(u64)max17042_test_wire_xfers(t));
+	KUNIT_EXPECT_EQ(test, t->chip.stats.reads[reg], 1);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.reads[reg + count - 1], 1);
+}
+
+/* Write count registers from reg, check data and the transfers it took */
+static void max17042_bus_test_write(struct kunit *test, u32 func, u8 reg,
+				    int count, unsigned int i2c,
+				    unsigned int blocks, unsigned int words)
+{
+	struct max17042_test *t = test->priv;
+	u16 *buf;
+	int i;
+
+	buf = kunit_kcalloc(test, count, sizeof(*buf), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	for (i = 0; i < count; i++)
+		buf[i] = 0xa500 + i;
+
+	t->chip.i2c_func = func;
+	KUNIT_ASSERT_EQ(test, regmap_bulk_write(t->chip.regmap, reg, buf,
+						count), 0);
+
+	for (i = 0; i < count; i++)
+		KUNIT_EXPECT_EQ_MSG(test, t->regs[reg + i], buf[i],
+				    "register 0x%02x", reg + i);
+	/* Neighbours are left alone */
+	KUNIT_EXPECT_EQ(test, t->regs[reg - 1],
+			(u16)((reg - 1) << 8 | (~(reg - 1) & 0xff)));
+	KUNIT_EXPECT_EQ(test, t->regs[reg + count],
+			(u16)((reg + count) << 8 | (~(reg + count) & 0xff)));
+
+	KUNIT_EXPECT_EQ(test, t->i2c_xfers, i2c);
+	KUNIT_EXPECT_EQ(test, t->block_xfers, blocks);
+	KUNIT_EXPECT_EQ(test, t->word_xfers, words);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.xfers,
+			(u64)max17042_test_wire_xfers(t));
+	KUNIT_EXPECT_EQ(test, t->chip.stats.writes[reg], 1);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.writes[reg + count - 1], 1);
+}
+
+#define MAX17042_TEST_FUNC_WORD		I2C_FUNC_SMBUS_WORD_DATA
+#define MAX17042_TEST_FUNC_BLOCK	(I2C_FUNC_SMBUS_WORD_DATA | \
+					 I2C_FUNC_SMBUS_I2C_BLOCK)
+
+/* The snapshot window: one combined transfer on a plain I2C adapter */
+static void max17042_bus_test_read_i2c(struct kunit *test)
+{
+	max17042_bus_test_read(test, I2C_FUNC_I2C, MAX17042_STATUS,
+			       MAX17042_SNAP_LO_REGS, 1, 0, 0);
+}
+
+/* 66 bytes go as 32 + 32 + 2, each chunk addressed at reg + i / 2 */
+static void max17042_bus_test_read_block(struct kunit *test)
+{
+	max17042_bus_test_read(test, MAX17042_TEST_FUNC_BLOCK,
+			       MAX17042_STATUS, MAX17042_SNAP_LO_REGS,
+			       0, 3, 0);
+}
+
+/* Exactly one I2C-block transfer worth, and one register more */
+static void max17042_bus_test_read_block_boundary(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	max17042_bus_test_read(test, MAX17042_TEST_FUNC_BLOCK,
+			       MAX17042_MODELChrTbl, 16, 0, 1, 0);
+
+	t->block_xfers = 0;
+	memset(&t->chip.stats, 0, sizeof(t->chip.stats));
+	max17042_bus_test_read(test, MAX17042_TEST_FUNC_BLOCK,
+			       MAX17042_MODELChrTbl, 17, 0, 2, 0);
+}
+
+static void max17042_bus_test_read_word(struct kunit *test)
+{
+	max17042_bus_test_read(test, MAX17042_TEST_FUNC_WORD,
+			       MAX17042_STATUS, MAX17042_SNAP_LO_REGS,
+			       0, 0, MAX17042_SNAP_LO_REGS);
+}
+
+/* Single registers stay on word transfers even with I2C-block support */
+static void max17042_bus_test_read_single(struct kunit *test)
+{
+	max17042_bus_test_read(test, MAX17042_TEST_FUNC_BLOCK, MAX17042_VCELL,
+			       1, 0, 0, 1);
+}
+
+/* A short I2C-block read must fail rather than leave stale data behind */
+static void max17042_bus_test_read_short(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+	u16 buf[MAX17042_SNAP_LO_REGS];
+
+	t->chip.i2c_func = MAX17042_TEST_FUNC_BLOCK;
+	t->short_block = true;
+	KUNIT_EXPECT_EQ(test, regmap_bulk_read(t->chip.regmap, MAX17042_STATUS,
+					       buf, ARRAY_SIZE(buf)), -EIO);
+	/* Gives up after the first chunk */
+	KUNIT_EXPECT_EQ(test, t->block_xfers, 1);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.xfers, 1);
+}
+
+/* The model table: one master send with the register address in front */
+static void max17042_bus_test_write_i2c(struct kunit *test)
+{
+	max17042_bus_test_write(test, I2C_FUNC_I2C, MAX17042_MODELChrTbl,
+				MAX17042_CHARACTERIZATION_DATA_SIZE, 1, 0, 0);
+}
+
+/* 96 bytes go as 32 + 32 + 32 */
+static void max17042_bus_test_write_block(struct kunit *test)
+{
+	max17042_bus_test_write(test, MAX17042_TEST_FUNC_BLOCK,
+				MAX17042_MODELChrTbl,
+				MAX17042_CHARACTERIZATION_DATA_SIZE, 0, 3, 0);
+}
+
+/* 40 bytes go as 32 + 8 */
+static void max17042_bus_test_write_block_partial(struct kunit *test)
+{
+	max17042_bus_test_write(test, MAX17042_TEST_FUNC_BLOCK,
+				MAX17042_MODELChrTbl + 4, 20, 0, 2, 0);
+}
+
+static void max17042_bus_test_write_word(struct kunit *test)
+{
+	max17042_bus_test_write(test, MAX17042_TEST_FUNC_WORD,
+				MAX17042_MODELChrTbl,
+				MAX17042_CHARACTERIZATION_DATA_SIZE, 0, 0,
+				MAX17042_CHARACTERIZATION_DATA_SIZE);
+}
+
+static void max17042_bus_test_write_single(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	t->chip.i2c_func = MAX17042_TEST_FUNC_BLOCK;
+	KUNIT_ASSERT_EQ(test, regmap_write(t->chip.regmap, MAX17042_CONFIG,
+					   0x2210), 0);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_CONFIG], 0x2210);
+	KUNIT_EXPECT_EQ(test, t->word_xfers, 1);
+	KUNIT_EXPECT_EQ(test, t->block_xfers, 0);
+}
+
+static struct kunit_case max17042_bus_test_cases[] = {
+	KUNIT_CASE(max17042_bus_test_read_i2c),
+	KUNIT_CASE(max17042_bus_test_read_block),
+	KUNIT_CASE(max17042_bus_test_read_block_boundary),
+	KUNIT_CASE(max17042_bus_test_read_word),
+	KUNIT_CASE(max17042_bus_test_read_single),
+	KUNIT_CASE(max17042_bus_test_read_short),
+	KUNIT_CASE(max17042_bus_test_write_i2c),
+	KUNIT_CASE(max17042_bus_test_write_block),
+	KUNIT_CASE(max17042_bus_test_write_block_partial),
+	KUNIT_CASE(max17042_bus_test_write_word),
+	KUNIT_CASE(max17042_bus_test_write_single),
+	{}
+};
+
+static struct kunit_suite max17042_bus_test_suite = {
+	.name = "max17042-bus",
+	.init = max17042_bus_test_init,
+	.exit = max17042_test_exit,
+	.test_cases = max17042_bus_test_cases,
+};
+
+/*
+ * Gauge behaviour the init paths depend on: the model table reads back as
+ * zeros and ignores writes while locked, and a ModelCfg refresh completes
+ * at once.
+ */
+static bool max17042_test_model_locked(struct max17042_test *t, u8 reg)
+{
+	return reg >= MAX17042_MODELChrTbl &&
+	       reg < MAX17042_MODELChrTbl + MAX17042_CHARACTERIZATION_DATA_SIZE &&
+	       (t->regs[MAX17042_MLOCKReg1] != MODEL_UNLOCK1 ||
+		t->regs[MAX17042_MLOCKReg2] != MODEL_UNLOCK2);
+}
+
+static u16 max17042_test_read_reg(struct max17042_test *t, u8 reg)
+{
+	return max17042_test_model_locked(t, reg) ? 0 : t->regs[reg];
+}
+
+static void max17042_test_write_reg(struct max17042_test *t, u8 reg, u16 val)
+{
+	if (max17042_test_model_locked(t, reg))
+		return;
+	if (reg == MAX17055_ModelCfg && t->chip.info->has_ez_config)
+		val &= ~MODELCFG_REFRESH_BIT;
+
+	t->regs[reg] = val;
+}
+
+/*
+ * In-memory regmap bus. Each call is accounted as one transfer, as on a
+ * plain I2C adapter, so the counts asserted below do not depend on the
+ * adapter and a change that adds a register access to a hot path fails.
+ */
+static int max17042_test_ram_read(void *context, const void *reg_buf,
+				  size_t reg_size, void *val_buf,
+				  size_t val_size)
+{
+	struct max17042_chip *chip = context;
+	struct max17042_test *t = container_of(chip, struct max17042_test,
+					       chip);
+	u8 reg = *(const u8 *)reg_buf;
+	size_t i;
+
+	for (i = 0; i < val_size / 2; i++)
+		put_unaligned_le16(max17042_test_read_reg(t, reg + i),
+				   val_buf + 2 * i);
+
+	max17042_account(chip, reg, val_size / 2, false, 1, 0);
+	return 0;
+}
+
+static int max17042_test_ram_write(void *context, const void *data,
+				   size_t count)
+{
+	struct max17042_chip *chip = context;
+	struct max17042_test *t = container_of(chip, struct max17042_test,
+					       chip);
+	const u8 *buf = data;
+	size_t i;
+
+	for (i = 0; i < (count - 1) / 2; i++)
+		max17042_test_write_reg(t, buf[0] + i,
+					get_unaligned_le16(buf + 1 + 2 * i));
+
+	max17042_account(chip, buf[0], (count - 1) / 2, true, 1, 0);
+	return 0;
+}
+
+static const struct regmap_bus max17042_test_ram_bus = {
+	.read = max17042_test_ram_read,
+	.write = max17042_test_ram_write,
+};
+
+static const struct max17042_reg_data max17042_test_regs[] = {
+	{ MAX17042_STATUS,	0x0000 },
+	{ MAX17042_TALRT_Th,	0x3cf6 },	/* 60 C / -10 C */
+	{ MAX17042_RepCap,	0x0800 },
+	{ MAX17042_RepSOC,	0x3200 },	/* 50 % */
+	{ MAX17042_TEMP,	0x1900 },	/* 25 C */
+	{ MAX17042_VCELL,	0xd000 },	/* 4.16 V */
+	{ MAX17042_Current,	0xff00 },
+	{ MAX17042_AvgCurrent,	0x0100 },
+	{ MAX17042_FullCAP,	0x1000 },
+	{ MAX17042_TTE,		0x0100 },
+	{ MAX17042_V_empty,	0x9661 },	/* 3.0 V */
+	{ MAX17042_Cycles,	0x0012 },
+	{ MAX17042_DesignCap,	0x1000 },
+	{ MAX17042_AvgVCELL,	0xcf00 },	/* 4.14 V */
+	{ MAX17042_MinMaxVolt,	0xd2a0 },	/* 4.2 V / 3.2 V */
+	{ MAX17042_ICHGTerm,	0x0280 },
+	{ MAX17055_TTF,		0x0200 },
+	{ MAX17042_FullCAP0,	0x1000 },
+	{ MAX17047_V_empty,	0x9661 },
+	{ MAX17042_FSTAT,	0x0000 },
+	{ MAX17042_QH,		0x0100 },
+	{ MAX17042_MLOCKReg1,	MODEL_LOCK1 },
+	{ MAX17042_MLOCKReg2,	MODEL_LOCK2 },
+	{ MAX17055_POWER,	0x0010 },
+	{ MAX17055_AvgPower,	0xfff0 },
+	{ MAX17055_HibCfg,	0x870c },
+	{ MAX17055_ModelCfg,	0x0000 },
+	{ MAX17042_OCVInternal,	0xd100 },	/* 4.18 V */
+	{ MAX17042_VFSOC,	0x3200 },
+};
+
+struct max17042_test_prop {
+	enum power_supply_property psp;
+	unsigned int xfers;
+	int val;
+};
+
+/* STATUS is left out, it asks the power supply core about chargers */
+static const struct max17042_test_prop max17042_test_props[] = {
+	{ POWER_SUPPLY_PROP_PRESENT,		1, 1 },
+	{ POWER_SUPPLY_PROP_CYCLE_COUNT,	1, 18 },
+	{ POWER_SUPPLY_PROP_VOLTAGE_MAX,	1, 4200000 },
+	{ POWER_SUPPLY_PROP_VOLTAGE_MIN,	1, 3200000 },
+	{ POWER_SUPPLY_PROP_VOLTAGE_MIN_DESIGN,	1, 3000000 },
+	{ POWER_SUPPLY_PROP_VOLTAGE_NOW,	1, 4160000 },
+	{ POWER_SUPPLY_PROP_VOLTAGE_AVG,	1, 4140000 },
+	{ POWER_SUPPLY_PROP_VOLTAGE_OCV,	1, 4180000 },
+	{ POWER_SUPPLY_PROP_CAPACITY,		1, 50 },
+	{ POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN,	1, 2048000 },
+	{ POWER_SUPPLY_PROP_CHARGE_FULL,	1, 2048000 },
+	{ POWER_SUPPLY_PROP_CHARGE_NOW,		1, 1024000 },
+	{ POWER_SUPPLY_PROP_CHARGE_COUNTER,	1, 128000 },
+	{ POWER_SUPPLY_PROP_CHARGE_TERM_CURRENT, 1, 100000 },
+	{ POWER_SUPPLY_PROP_TEMP,		1, 250 },
+	{ POWER_SUPPLY_PROP_TEMP_ALERT_MIN,	1, -100 },
+	{ POWER_SUPPLY_PROP_TEMP_ALERT_MAX,	1, 600 },
+	/* AvgVCELL, VCELL and TEMP */
+	{ POWER_SUPPLY_PROP_HEALTH,		3, POWER_SUPPLY_HEALTH_GOOD },
+	{ POWER_SUPPLY_PROP_TIME_TO_EMPTY_NOW,	1, 1440 },
+	{ POWER_SUPPLY_PROP_CURRENT_NOW,	1, -40000 },
+	{ POWER_SUPPLY_PROP_CURRENT_AVG,	1, 40000 },
+};
+
+static const struct max17042_test_prop max17055_test_props[] = {
+	{ POWER_SUPPLY_PROP_TIME_TO_FULL_NOW,	1, 2880 },
+	{ POWER_SUPPLY_PROP_POWER_NOW,		1, 12800 },
+	{ POWER_SUPPLY_PROP_POWER_AVG,		1, -12800 },
+};
+
+struct max17042_test_param {
+	enum max170xx_chip_type type;
+	const char *name;
+	unsigned int por_init_xfers;
+};
+
+/*
+ * POR init: the platform config_data flow on MAX17042/47/50, the EZ flow
+ * on MAX17055. MAX17047/50 verify four QRTbl registers where MAX17042
+ * writes EmptyTempCo and verifies K_empty0, and write FullSOCThr too.
+ */
+static const struct max17042_test_param max17042_test_params[] = {
+	{ MAXIM_DEVICE_TYPE_MAX17042, "max17042", 79 },
+	{ MAXIM_DEVICE_TYPE_MAX17047, "max17047", 81 },
+	{ MAXIM_DEVICE_TYPE_MAX17050, "max17050", 81 },
+	{ MAXIM_DEVICE_TYPE_MAX17055, "max17055", 15 },
+};
+
+static void max17042_test_param_desc(const struct max17042_test_param *param,
+				     char *desc)
+{
+	strscpy(desc, param->name, KUNIT_PARAM_DESC_SIZE);
+}
+
+KUNIT_ARRAY_PARAM(max17042_test, max17042_test_params,
+		  max17042_test_param_desc);
+
+static int max17042_test_init(struct kunit *test)
+{
+	const struct max17042_test_param *param = test->param_value;
+	struct max17042_platform_data *pdata;
+	struct max17042_chip *chip;
+	struct max17042_test *t;
+	int ret, i;
+
+	ret = max17042_test_setup(test, param->type, &max17042_test_ram_bus);
+	if (ret)
+		return ret;
+
+	t = test->priv;
+	for (i = 0; i < ARRAY_SIZE(max17042_test_regs); i++)
+		t->regs[max17042_test_regs[i].addr] = max17042_test_regs[i].data;
+
+	pdata = &t->pdata;
+	pdata->enable_current_sense = true;
+	pdata->r_sns = MAX17042_DEFAULT_SNS_RESISTOR;
+	pdata->vmin = MAX17042_DEFAULT_VMIN;
+	pdata->vmax = MAX17042_DEFAULT_VMAX;
+	pdata->temp_min = MAX17042_DEFAULT_TEMP_MIN;
+	pdata->temp_max = MAX17042_DEFAULT_TEMP_MAX;
+	/* No supply is registered, keep alerts away from power_supply_changed */
+	pdata->notify_delta_soc = 100;
+
+	chip = &t->chip;
+	seqlock_init(&chip->snap_lock);
+	mutex_init(&chip->notify_lock);
+	mutex_init(&chip->learned_lock);
+	max17042_init_scales(chip);
+	chip->init_complete = 1;
+
+	return 0;
+}
+
+static void max17042_test_reset_stats(struct max17042_test *t)
+{
+	memset(&t->chip.stats, 0, sizeof(t->chip.stats));
+}
+
+static void max17042_test_check_props(struct kunit *test,
+				      const struct max17042_test_prop *props,
+				      int count, bool cached)
+{
+	struct max17042_test *t = test->priv;
+	union power_supply_propval val;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		max17042_test_reset_stats(t);
+		val.intval = 0;
+		KUNIT_EXPECT_EQ_MSG(test, __max17042_get_property(&t->chip,
+						props[i].psp, &val), 0,
+				    "property %d", props[i].psp);
+		KUNIT_EXPECT_EQ_MSG(test, val.intval, props[i].val,
+				    "property %d", props[i].psp);
+		KUNIT_EXPECT_EQ_MSG(test, t->chip.stats.xfers,
+				    cached ? 0 : props[i].xfers,
+				    "property %d", props[i].psp);
+	}
+}
+
+static void max17042_test_get_property(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	max17042_test_check_props(test, max17042_test_props,
+				  ARRAY_SIZE(max17042_test_props), false);
+	if (t->chip.info->has_power)
+		max17042_test_check_props(test, max17055_test_props,
+					  ARRAY_SIZE(max17055_test_props),
+					  false);
+}
+
+/* With the snapshot enabled properties cost no bus traffic at all */
+static void max17042_test_get_property_cached(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+	bool has_power = t->chip.info->has_power;
+
+	t->pdata.snapshot_interval_ms = 1000;
+	KUNIT_ASSERT_EQ(test, max17042_snapshot_refresh(&t->chip), 0);
+	/* STATUS..TTF, OCVInternal..VFSOC, QH, VEmpty, power and peak power */
+	KUNIT_EXPECT_EQ(test, t->chip.stats.xfers, has_power ? 6 : 4);
+
+	max17042_test_check_props(test, max17042_test_props,
+				  ARRAY_SIZE(max17042_test_props), true);
+	if (has_power)
+		max17042_test_check_props(test, max17055_test_props,
+					  ARRAY_SIZE(max17055_test_props),
+					  true);
+}
+
+static void max17042_test_run_irq(struct kunit *test, unsigned int xfers)
+{
+	struct max17042_test *t = test->priv;
+	struct max17042_chip *chip = &t->chip;
+	u16 alert;
+
+	chip->dsoc_alert = chip->info->has_dsoc_alert;
+	alert = chip->dsoc_alert ? STATUS_DSOCI_BIT : STATUS_SMX_BIT;
+	t->regs[MAX17042_STATUS] = STATUS_POR_BIT | alert;
+	t->regs[MAX17042_SALRT_Th] = 0;
+
+	max17042_test_reset_stats(t);
+	KUNIT_EXPECT_EQ(test, max17042_thread_handler(0, chip), IRQ_HANDLED);
+	KUNIT_EXPECT_EQ(test, chip->stats.xfers, xfers);
+
+	/* Alerts are cleared, POR is left for the init worker */
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_STATUS], STATUS_POR_BIT);
+	if (!chip->dsoc_alert)
+		KUNIT_EXPECT_EQ(test, t->regs[MAX17042_SALRT_Th],
+				0x3331);	/* 51 % / 49 % */
+	KUNIT_EXPECT_EQ(test, chip->stats.irqs, 1);
+	KUNIT_EXPECT_EQ(test, chip->stats.notify_sent, 0);
+}
+
+/*
+ * Read STATUS, re-arm SALRT_Th (RepSOC, SALRT_Th) unless dSOCi is in use,
+ * clear STATUS (read, write) and read RepSOC for the SOC delta.
+ */
+static void max17042_test_irq(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	max17042_test_run_irq(test, t->chip.info->has_dsoc_alert ? 4 : 6);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.notify_suppressed, 1);
+}
+
+/* Without deltas the notification filter costs no bus traffic */
+static void max17042_test_irq_unfiltered(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	t->pdata.notify_delta_soc = 0;
+	/* Defer the notification, there is no supply to send it to */
+	t->pdata.notify_min_interval_ms = 1000;
+	t->chip.notify_last = jiffies;
+
+	max17042_test_run_irq(test, t->chip.info->has_dsoc_alert ? 3 : 5);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.notify_deferred, 1);
+}
+
+/* The snapshot refresh replaces the RepSOC read of the filter */
+static void max17042_test_irq_cached(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	t->pdata.snapshot_interval_ms = 1000;
+	max17042_test_run_irq(test, 9);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.notify_suppressed, 1);
+	KUNIT_EXPECT_TRUE(test, t->chip.snap.valid);
+}
+
+static void max17042_test_por_init_ez(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+	struct max17055_ez_config *ez = &t->chip.ez;
+
+	ez->design_cap = 0x1000;
+	ez->dqacc = ez->design_cap / 32;
+	ez->dpacc = ez->dqacc * 51200 / ez->design_cap;
+	ez->ichg_term = 0x0280;
+	ez->vempty = 0x9661;
+	ez->model_cfg = MODELCFG_VCHG_BIT;
+
+	KUNIT_ASSERT_EQ(test, max17055_init_chip(&t->chip), 0);
+
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_DesignCap], ez->design_cap);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_dQacc], ez->dqacc);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_dPacc], ez->dpacc);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_ICHGTerm], ez->ichg_term);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17047_V_empty], ez->vempty);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17055_ModelCfg], MODELCFG_VCHG_BIT);
+	/* Hibernate is restored once the model is loaded */
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17055_HibCfg], 0x870c);
+}
+
+static void max17042_test_por_init_config(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+	const struct max17042_chip_info *info = t->chip.info;
+	struct max17042_config_data *config;
+	int i;
+
+	config = kunit_kzalloc(test, sizeof(*config), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, config);
+
+	/* Every POR override is non-zero, so every one is written */
+	for (i = 0; i < info->num_por_regs; i++)
+		put_unaligned((u16)(0x0100 + i), (u16 *)((u8 *)config +
+			      info->por_regs[i].offset));
+	for (i = 0; i < ARRAY_SIZE(config->cell_char_tbl); i++)
+		config->cell_char_tbl[i] = 0x1000 + i;
+	t->pdata.config_data = config;
+
+	KUNIT_ASSERT_EQ(test, max17042_init_chip(&t->chip), 0);
+
+	/* Loaded while unlocked, locked again afterwards */
+	for (i = 0; i < ARRAY_SIZE(config->cell_char_tbl); i++)
+		KUNIT_EXPECT_EQ(test, t->regs[MAX17042_MODELChrTbl + i],
+				config->cell_char_tbl[i]);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_MLOCKReg1], MODEL_LOCK1);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_MLOCKReg2], MODEL_LOCK2);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_DesignCap], config->design_cap);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_FullCAPNom],
+			config->fullcapnom);
+}
+
+static void max17042_test_por_init(struct kunit *test)
+{
+	const struct max17042_test_param *param = test->param_value;
+	struct max17042_test *t = test->priv;
+
+	t->regs[MAX17042_STATUS] = STATUS_POR_BIT;
+	max17042_test_reset_stats(t);
+
+	if (t->chip.info->has_ez_config)
+		max17042_test_por_init_ez(test);
+	else
+		max17042_test_por_init_config(test);
+
+	KUNIT_EXPECT_EQ(test, t->chip.stats.xfers, param->por_init_xfers);
+	KUNIT_EXPECT_EQ(test, t->regs[MAX17042_STATUS], 0);
+}
+
+#ifdef CONFIG_PM_SLEEP
+/* STATUS .. RepSOC in one read, nothing to re-arm without an IRQ */
+static void max17042_test_resume(struct kunit *test)
+{
+	struct max17042_test *t = test->priv;
+
+	dev_set_drvdata(&t->client->dev, &t->chip);
+	max17042_test_reset_stats(t);
+	KUNIT_EXPECT_EQ(test, max17042_resume(&t->client->dev), 0);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.xfers, 1);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.reads[MAX17042_RepSOC], 1);
+	KUNIT_EXPECT_EQ(test, t->chip.stats.reads[MAX17042_TTE], 0);
+}
+#endif
+
+static struct kunit_case max17042_test_cases[] = {
+	KUNIT_CASE_PARAM(max17042_test_get_property,
+			 max17042_test_gen_params),
+	KUNIT_CASE_PARAM(max17042_test_get_property_cached,
+			 max17042_test_gen_params),
+	KUNIT_CASE_PARAM(max17042_test_irq, max17042_test_gen_params),
+	KUNIT_CASE_PARAM(max17042_test_irq_unfiltered,
+			 max17042_test_gen_params),
+	KUNIT_CASE_PARAM(max17042_test_irq_cached, max17042_test_gen_params),
+	KUNIT_CASE_PARAM(max17042_test_por_init, max17042_test_gen_params),
+#ifdef CONFIG_PM_SLEEP
+	KUNIT_CASE_PARAM(max17042_test_resume, max17042_test_gen_params),
+#endif
+	{}
+};
+
+static struct kunit_suite max17042_test_suite = {
+	.name = "max17042",
+	.init = max17042_test_init,
+	.exit = max17042_test_exit,
+	.test_cases = max17042_test_cases,
+};
+
+kunit_test_suites(&max17042_bus_test_suite, &max17042_test_suite);
@@ -0,0 +1,163 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Tracepoints for the Maxim 17042 fuel gauge driver
+ *
+ * Register accesses are emitted from the regmap bus, in the context of the
+ * task that caused them, so they nest between the get_property start/done,
+ * irq and init_chip events of the same pid.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM max17042
+
+#if !defined(_MAX17042_BATTERY_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MAX17042_BATTERY_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(max17042_reg,
+
+	TP_PROTO(struct device *dev, u8 reg, u16 val, size_t count,
+		 u64 duration_ns, int ret),
+
+	TP_ARGS(dev, reg, val, count, duration_ns, ret),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(u8, reg)
+		__field(u16, val)
+		__field(u16, count)
+		__field(u64, duration_ns)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->reg = reg;
+		__entry->val = val;
+		__entry->count = count;
+		__entry->duration_ns = duration_ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s reg=0x%02x val=0x%04x count=%u duration_ns=%llu ret=%d",
+		  __get_str(name), __entry->reg, __entry->val, __entry->count,
+		  __entry->duration_ns, __entry->ret)
+);
+
+/* val is the first register of a bulk access */
+DEFINE_EVENT(max17042_reg, max17042_reg_read,
+
+	TP_PROTO(struct device *dev, u8 reg, u16 val, size_t count,
+		 u64 duration_ns, int ret),
+
+	TP_ARGS(dev, reg, val, count, duration_ns, ret)
+);
+
+DEFINE_EVENT(max17042_reg, max17042_reg_write,
+
+	TP_PROTO(struct device *dev, u8 reg, u16 val, size_t count,
+		 u64 duration_ns, int ret),
+
+	TP_ARGS(dev, reg, val, count, duration_ns, ret)
+);
+
+TRACE_EVENT(max17042_get_property_start,
+
+	TP_PROTO(struct device *dev, int psp),
+
+	TP_ARGS(dev, psp),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(int, psp)
+	),
+
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->psp = psp;
+	),
+
+	TP_printk("%s psp=%d", __get_str(name), __entry->psp)
+);
+
+TRACE_EVENT(max17042_get_property_done,
+
+	TP_PROTO(struct device *dev, int psp, int intval, u64 duration_ns,
+		 int ret),
+
+	TP_ARGS(dev, psp, intval, duration_ns, ret),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(int, psp)
+		__field(int, intval)
+		__field(u64, duration_ns)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->psp = psp;
+		__entry->intval = intval;
+		__entry->duration_ns = duration_ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s psp=%d intval=%d duration_ns=%llu ret=%d",
+		  __get_str(name), __entry->psp, __entry->intval,
+		  __entry->duration_ns, __entry->ret)
+);
+
+TRACE_EVENT(max17042_irq,
+
+	TP_PROTO(struct device *dev, u16 status, u64 duration_ns),
+
+	TP_ARGS(dev, status, duration_ns),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(u16, status)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->status = status;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("%s status=0x%04x duration_ns=%llu", __get_str(name),
+		  __entry->status, __entry->duration_ns)
+);
+
+TRACE_EVENT(max17042_init_chip,
+
+	TP_PROTO(struct device *dev, u64 duration_ns, int ret),
+
+	TP_ARGS(dev, duration_ns, ret),
+
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(u64, duration_ns)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->duration_ns = duration_ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s duration_ns=%llu ret=%d", __get_str(name),
+		  __entry->duration_ns, __entry->ret)
+);
+
+#endif /* _MAX17042_BATTERY_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE max17042_battery_trace
+#include <trace/define_trace.h>
@@ -33,56 +33,991 @@
 
 #include "MAX17055.h"
 
+#if MAX17055_KVSTORE
+#include "kvstore_global_api.h"
+#endif
+
+//******************************************************************************
+// Registers are little endian; each value only overlaps its own bytes
+static void decodeRegs(uint16_t *value, int count)
+{
+    const unsigned char *buf = (const unsigned char *)value;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        value[i] = (uint16_t)((buf[2 * i + 1] << 8) | buf[2 * i]);
+    }
+}
+
+//******************************************************************************
+// raw * scale in Q16, rounded; 64-bit multiply but no division or float
+static int32_t scaleQ16(int raw, uint32_t scale)
+{
+    return (int32_t)(((int64_t)raw * scale + 0x8000) >> 16);
+}
+
+//******************************************************************************
+static int32_t uvFromVCell(int raw)
+{
+    return (raw * MAX17055_V_LSB_UV_NUM) >> MAX17055_V_LSB_UV_SHIFT;
+}
+
+//******************************************************************************
+static int32_t mcFromTemp(int raw)
+{
+    return (raw * MAX17055_T_LSB_MC_NUM) / (1 << MAX17055_T_LSB_MC_SHIFT);
+}
+
+//******************************************************************************
+static int clampInt(int value, int min, int max)
+{
+    return (value < min) ? min : ((value > max) ? max : value);
+}
+
+//******************************************************************************
+static int roundInt(float value)
+{
+    return (int)((value < 0) ? (value - 0.5f) : (value + 0.5f));
+}
+
+//******************************************************************************
+MAX17055::MAX17055(MAX17055Transport &transport, int address) :
+    transport(transport),
+    addr(address)
+#if DEVICE_I2C_ASYNCH
+    , async_op(ASYNC_IDLE)
+#endif
+#if DEVICE_INTERRUPTIN
+    , alert_queue(NULL)
+#endif
+#if MAX17055_KVSTORE
+    , kv_key(MAX17055_KV_KEY)
+#endif
+{
+}
+
+#ifdef __MBED__
 //******************************************************************************
 MAX17055::MAX17055(I2C &i2c, int address) :
-    i2c(i2c),
+    mbed_transport(&i2c),
+    transport(mbed_transport),
     addr(address)
+#if DEVICE_I2C_ASYNCH
+    , async_op(ASYNC_IDLE)
+#endif
+#if DEVICE_INTERRUPTIN
+    , alert_queue(NULL)
+#endif
+#if MAX17055_KVSTORE
+    , kv_key(MAX17055_KV_KEY)
+#endif
 {
 }
+#endif
 
 //******************************************************************************
 MAX17055::~MAX17055()
 {
 }
 
-//******************************************************************************
-void MAX17055::init(float r_sense)
-{
-    this->r_sense = r_sense;
-    i_lsb = MAX17055_I_LSB_UV / r_sense;
-    i_min_max_lsb = MAX17055_I_MAX_MIN_LSB_MV / r_sense;
+//******************************************************************************
+void MAX17055::init(float r_sense)
+{
+    this->r_sense = r_sense;
+    r_sense_inv = 1.0f / r_sense;
+    i_lsb = MAX17055_I_LSB_UV / r_sense;
+    i_min_max_lsb = MAX17055_I_MAX_MIN_LSB_MV / r_sense;
+    init_uohm((uint32_t)(r_sense * 1000000.0f + 0.5f));
+}
+
+//******************************************************************************
+int MAX17055::init_uohm(uint32_t r_sense_uohm)
+{
+    if (r_sense_uohm == 0) {
+        return MAX17055_ERROR;
+    }
+
+    i_scale = (MAX17055_I_Q16_NUM + r_sense_uohm / 2) / r_sense_uohm;
+    cap_scale = (MAX17055_CAP_Q16_NUM + r_sense_uohm / 2) / r_sense_uohm;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::init(float r_sense, const ez_config_t &cfg,
+                   const custom_model_t *model)
+{
+    init(r_sense);
+
+    return initGauge(cfg, model);
+}
+
+//******************************************************************************
+int MAX17055::init_uohm(uint32_t r_sense_uohm, const ez_config_t &cfg,
+                        const custom_model_t *model)
+{
+    if (init_uohm(r_sense_uohm)) {
+        return MAX17055_ERROR;
+    }
+
+    return initGauge(cfg, model);
+}
+
+//******************************************************************************
+int MAX17055::initGauge(const ez_config_t &cfg, const custom_model_t *model)
+{
+    reg_write_t ez[5];
+    uint16_t dq_acc, dp_acc, model_cfg;
+    int status, hib_cfg;
+
+    // dPAcc is derived from DesignCap, reject it before touching the gauge
+    if (cfg.design_cap == 0) {
+        return MAX17055_ERROR;
+    }
+
+    if (readReg16(MAX17055::STATUS, &status)) {
+        return MAX17055_ERROR;
+    }
+
+    if (!(status & MAX17055_STATUS_POR)) {
+        return MAX17055_NO_ERROR;
+    }
+
+    // Wait for the startup measurements to complete
+    if (pollReg(MAX17055::F_STAT, MAX17055_FSTAT_DNR)) {
+        return MAX17055_ERROR;
+    }
+
+    // Exit hibernate so the writes below take effect immediately
+    if (readReg16(MAX17055::HIB_CFG, &hib_cfg) ||
+        writeReg(MAX17055::COMMAND, (uint16_t)MAX17055_CMD_SOFT_WAKEUP) ||
+        writeReg(MAX17055::HIB_CFG, (uint16_t)0) ||
+        writeReg(MAX17055::COMMAND, (uint16_t)0)) {
+        return MAX17055_ERROR;
+    }
+
+    dq_acc = cfg.design_cap / 32;
+    if (cfg.high_charge_voltage) {
+        dp_acc = (uint32_t)dq_acc * 51200 / cfg.design_cap;
+        model_cfg = MAX17055_MODELCFG_REFRESH | MAX17055_MODELCFG_VCHG;
+    } else {
+        dp_acc = (uint32_t)dq_acc * 44138 / cfg.design_cap;
+        model_cfg = MAX17055_MODELCFG_REFRESH;
+    }
+
+    ez[0].reg = MAX17055::DESIGN_CAP;
+    ez[0].value = cfg.design_cap;
+    ez[1].reg = MAX17055::DQ_ACC;
+    ez[1].value = dq_acc;
+    ez[2].reg = MAX17055::I_CHG_TERM;
+    ez[2].value = cfg.i_chg_term;
+    ez[3].reg = MAX17055::V_EMPTY;
+    ez[3].value = cfg.v_empty;
+    ez[4].reg = MAX17055::DP_ACC;
+    ez[4].value = dp_acc;
+
+    if (writeRegs(ez, 5)) {
+        return MAX17055_ERROR;
+    }
+
+    if (model) {
+        if (loadModel(*model)) {
+            return MAX17055_ERROR;
+        }
+        model_cfg = MAX17055_MODELCFG_REFRESH | model->model_cfg;
+    }
+
+    // Refresh clears itself once the model has been loaded
+    if (writeReg(MAX17055::MODEL_CFG, model_cfg) ||
+        pollReg(MAX17055::MODEL_CFG, MAX17055_MODELCFG_REFRESH)) {
+        return MAX17055_ERROR;
+    }
+
+    if (writeReg(MAX17055::HIB_CFG, (uint16_t)hib_cfg)) {
+        return MAX17055_ERROR;
+    }
+
+#if MAX17055_KVSTORE
+    // Start from what was learned before the POR, if anything was saved
+    restoreLearned();
+#endif
+
+    return updateReg(MAX17055::STATUS, MAX17055_STATUS_POR, 0);
+}
+
+#if MAX17055_KVSTORE
+// Blob layout: version, then the registers below little endian, then CRC-8
+static const MAX17055::reg_t learned_regs[] = {
+    MAX17055::R_COMP0,
+    MAX17055::TEMP_CO,
+    MAX17055::FULL_CAP_REP,
+    MAX17055::FULL_CAP_NOM,
+    MAX17055::CYCLES,
+    MAX17055::DQ_ACC,
+    MAX17055::DP_ACC
+};
+
+enum {
+    LEARNED_R_COMP0,
+    LEARNED_TEMP_CO,
+    LEARNED_FULL_CAP_REP,
+    LEARNED_FULL_CAP_NOM,
+    LEARNED_CYCLES,
+    LEARNED_DQ_ACC,
+    LEARNED_DP_ACC,
+    LEARNED_NUM
+};
+
+//******************************************************************************
+// CRC-8, polynomial 0x07
+static uint8_t crc8(const uint8_t *buf, int len)
+{
+    uint8_t crc = 0;
+    int i, bit;
+
+    for (i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (bit = 0; bit < 8; bit++) {
+            crc = (uint8_t)((crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1));
+        }
+    }
+
+    return crc;
+}
+
+//******************************************************************************
+static int loadLearned(const char *key, uint16_t *value)
+{
+    uint8_t blob[MAX17055_LEARNED_SIZE];
+    size_t size;
+    int i;
+
+    if (kv_get(key, blob, sizeof(blob), &size) || (size != sizeof(blob)) ||
+        (blob[0] != MAX17055_LEARNED_VERSION) ||
+        (crc8(blob, sizeof(blob) - 1) != blob[sizeof(blob) - 1])) {
+        return MAX17055_ERROR;
+    }
+
+    for (i = 0; i < LEARNED_NUM; i++) {
+        value[i] = (uint16_t)(blob[1 + 2 * i] | (blob[2 + 2 * i] << 8));
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+static bool capMoved(uint16_t now, uint16_t then)
+{
+    uint32_t diff = (now > then) ? (now - then) : (then - now);
+
+    return (diff * 100) > then;
+}
+
+//******************************************************************************
+int MAX17055::saveLearned(bool force)
+{
+    uint8_t blob[MAX17055_LEARNED_SIZE];
+    uint16_t value[LEARNED_NUM];
+    uint16_t saved[LEARNED_NUM];
+    int v;
+    int i;
+
+    for (i = 0; i < LEARNED_NUM; i++) {
+        if (readReg16(learned_regs[i], &v)) {
+            return MAX17055_ERROR;
+        }
+        value[i] = v;
+    }
+
+    if (!force && !loadLearned(kv_key, saved) &&
+        (value[LEARNED_R_COMP0] == saved[LEARNED_R_COMP0]) &&
+        (value[LEARNED_TEMP_CO] == saved[LEARNED_TEMP_CO]) &&
+        !capMoved(value[LEARNED_FULL_CAP_REP], saved[LEARNED_FULL_CAP_REP]) &&
+        !capMoved(value[LEARNED_FULL_CAP_NOM], saved[LEARNED_FULL_CAP_NOM]) &&
+        ((uint16_t)(value[LEARNED_CYCLES] - saved[LEARNED_CYCLES]) <
+         MAX17055_LEARNED_CYCLES)) {
+        return MAX17055_NO_ERROR;
+    }
+
+    blob[0] = MAX17055_LEARNED_VERSION;
+    for (i = 0; i < LEARNED_NUM; i++) {
+        blob[1 + 2 * i] = value[i];
+        blob[2 + 2 * i] = value[i] >> 8;
+    }
+    blob[sizeof(blob) - 1] = crc8(blob, sizeof(blob) - 1);
+
+    if (kv_set(kv_key, blob, sizeof(blob), 0)) {
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::restoreLearned()
+{
+    uint16_t saved[LEARNED_NUM];
+    reg_write_t params[3];
+    int full_cap_nom, mix_soc;
+
+    if (loadLearned(kv_key, saved)) {
+        return MAX17055_ERROR;
+    }
+
+    params[0].reg = MAX17055::R_COMP0;
+    params[0].value = saved[LEARNED_R_COMP0];
+    params[1].reg = MAX17055::TEMP_CO;
+    params[1].value = saved[LEARNED_TEMP_CO];
+    params[2].reg = MAX17055::FULL_CAP_NOM;
+    params[2].value = saved[LEARNED_FULL_CAP_NOM];
+
+    if (writeRegs(params, 3)) {
+        return MAX17055_ERROR;
+    }
+
+    transport.delay_ms(350);
+
+    // Rescale MixCap to the restored capacity
+    if (readReg16(MAX17055::FULL_CAP_NOM, &full_cap_nom) ||
+        readReg16(MAX17055::MIX_SOC, &mix_soc)) {
+        return MAX17055_ERROR;
+    }
+
+    params[0].reg = MAX17055::MIX_CAP;
+    params[0].value = (uint32_t)mix_soc * full_cap_nom / 25600;
+    params[1].reg = MAX17055::FULL_CAP_REP;
+    params[1].value = saved[LEARNED_FULL_CAP_REP];
+
+    if (writeRegs(params, 2)) {
+        return MAX17055_ERROR;
+    }
+
+    params[0].reg = MAX17055::DP_ACC;
+    params[0].value = saved[LEARNED_DP_ACC];
+    params[1].reg = MAX17055::DQ_ACC;
+    params[1].value = saved[LEARNED_DQ_ACC];
+
+    if (writeRegs(params, 2)) {
+        return MAX17055_ERROR;
+    }
+
+    transport.delay_ms(350);
+
+    params[0].reg = MAX17055::CYCLES;
+    params[0].value = saved[LEARNED_CYCLES];
+
+    return writeRegs(params, 1);
+}
+#endif
+
+//******************************************************************************
+int MAX17055::loadModel(const custom_model_t &model)
+{
+    uint16_t check[MAX17055_MODEL_WORDS];
+    reg_write_t params[6];
+    int i;
+
+    if (writeReg(MAX17055::MODEL_LOCK1, (uint16_t)MAX17055_MODEL_UNLOCK1) ||
+        writeReg(MAX17055::MODEL_LOCK2, (uint16_t)MAX17055_MODEL_UNLOCK2)) {
+        return MAX17055_ERROR;
+    }
+
+    if (writeBlock(MAX17055::MODEL_DATA, model.data, MAX17055_MODEL_WORDS) ||
+        readRegs(MAX17055::MODEL_DATA, check, MAX17055_MODEL_WORDS) ||
+        memcmp(check, model.data, sizeof(check))) {
+        writeReg(MAX17055::MODEL_LOCK1, (uint16_t)0);
+        writeReg(MAX17055::MODEL_LOCK2, (uint16_t)0);
+        return MAX17055_ERROR;
+    }
+
+    // Once locked the table reads back as zeros
+    if (writeReg(MAX17055::MODEL_LOCK1, (uint16_t)0) ||
+        writeReg(MAX17055::MODEL_LOCK2, (uint16_t)0) ||
+        readRegs(MAX17055::MODEL_DATA, check, MAX17055_MODEL_WORDS)) {
+        return MAX17055_ERROR;
+    }
+
+    for (i = 0; i < MAX17055_MODEL_WORDS; i++) {
+        if (check[i]) {
+            return MAX17055_ERROR;
+        }
+    }
+
+    params[0].reg = MAX17055::R_COMP0;
+    params[0].value = model.r_comp0;
+    params[1].reg = MAX17055::TEMP_CO;
+    params[1].value = model.temp_co;
+    params[2].reg = MAX17055::QR_TABLE_00;
+    params[2].value = model.qr_table[0];
+    params[3].reg = MAX17055::QR_TABLE_10;
+    params[3].value = model.qr_table[1];
+    params[4].reg = MAX17055::QR_TABLE_20;
+    params[4].value = model.qr_table[2];
+    params[5].reg = MAX17055::QR_TABLE_30;
+    params[5].value = model.qr_table[3];
+
+    return writeRegs(params, 6);
+}
+
+//******************************************************************************
+int MAX17055::pollReg(reg_t reg, uint16_t mask)
+{
+    int value;
+    int tries;
+
+    for (tries = 0; tries < MAX17055_POLL_TRIES; tries++) {
+        if (readReg16(reg, &value)) {
+            return MAX17055_ERROR;
+        }
+
+        if (!(value & mask)) {
+            return MAX17055_NO_ERROR;
+        }
+
+        transport.delay_ms(MAX17055_POLL_MS);
+    }
+
+    return MAX17055_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::v_cell_uv(int32_t *value)
+{
+    int v;
+
+    if (v_cell(&v)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = uvFromVCell(v);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::avg_v_cell_uv(int32_t *value)
+{
+    int avc;
+
+    if (avg_v_cell(&avc)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = uvFromVCell(avc);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_volt_uv(int32_t *max, int32_t *min)
+{
+    int v_max, v_min;
+
+    if (max_min_volt(&v_max, &v_min)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = v_max * MAX17055_V_MAX_MIN_LSB_UV;
+    *min = v_min * MAX17055_V_MAX_MIN_LSB_UV;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::current_ua(int32_t *value)
+{
+    int i;
+
+    if (current(&i)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = scaleQ16(i, i_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::avg_current_ua(int32_t *value)
+{
+    int i_a;
+
+    if (avg_current(&i_a)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = scaleQ16(i_a, i_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_curr_ua(int32_t *max, int32_t *min)
+{
+    int i_max, i_min;
+
+    if (max_min_curr(&i_max, &i_min)) {
+        return MAX17055_ERROR;
+    }
+
+    // MaxMinCurr LSB is 256 Current LSBs
+    *max = scaleQ16(i_max * 256, i_scale);
+    *min = scaleQ16(i_min * 256, i_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::temp_mc(int32_t *value)
+{
+    int t;
+
+    if (temp(&t)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = mcFromTemp(t);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::avg_ta_mc(int32_t *value)
+{
+    int ta;
+
+    if (avg_ta(&ta)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = mcFromTemp(ta);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::rep_cap_uah(int32_t *value)
+{
+    int cap;
+
+    if (read<MAX17055::REP_CAP>(&cap)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = scaleQ16(cap, cap_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::full_cap_rep_uah(int32_t *value)
+{
+    int cap;
+
+    if (read<MAX17055::FULL_CAP_REP>(&cap)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = scaleQ16(cap, cap_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::status(int *value)
+{
+    return read<MAX17055::STATUS>(value);
+}
+
+//******************************************************************************
+int MAX17055::v_cell(int *value)
+{
+    return read<MAX17055::V_CELL>(value);
+}
+
+//******************************************************************************
+int MAX17055::v_cell(float *value)
+{
+    int v;
+
+    if (v_cell(&v)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = v * MAX17055_V_LSB_MV;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::avg_v_cell(int *value)
+{
+    return read<MAX17055::AVG_V_CELL>(value);
+}
+
+//******************************************************************************
+int MAX17055::avg_v_cell(float *value)
+{
+    int avc;
+
+    if (avg_v_cell(&avc)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = avc * MAX17055_V_LSB_MV;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_volt(int *max, int *min)
+{
+    char buf[2];
+
+    if (readReg(MAX17055::MAX_MIN_VOLT, buf, 2)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = (unsigned char)buf[1];
+    *min = (unsigned char)buf[0];
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_volt(float *max, float *min)
+{
+    int v_max, v_min;
+
+    if (max_min_volt(&v_max, &v_min)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = v_max * MAX17055_V_MAX_MIN_LSB_MV;
+    *min = v_min * MAX17055_V_MAX_MIN_LSB_MV;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::current(int *value)
+{
+    return read<MAX17055::CURRENT>(value);
+}
+
+//******************************************************************************
+int MAX17055::current(float *value)
+{
+    int i;
+
+    if (current(&i)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = i * i_lsb;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::avg_current(int *value)
+{
+    return read<MAX17055::AVG_CURRENT>(value);
+}
+
+//******************************************************************************
+int MAX17055::avg_current(float *value)
+{
+    int i_a;
+
+    if (avg_current(&i_a)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = i_a * i_lsb;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_curr(int *max, int *min)
+{
+    char buf[2];
+
+    if (readReg(MAX17055::MAX_MIN_CURR, buf, 2)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = (signed char)buf[1];
+    *min = (signed char)buf[0];
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_curr(float *max, float *min)
+{
+    int i_max, i_min;
+
+    if (max_min_curr(&i_max, &i_min)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = i_max * i_min_max_lsb;
+    *min = i_min * i_min_max_lsb;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::temp(int *value)
+{
+    return read<MAX17055::TEMP>(value);
+}
+
+//******************************************************************************
+int MAX17055::temp(float *value)
+{
+    int t;
+
+    if (temp(&t)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = t * (1.0f / 256);
+
+    return MAX17055_NO_ERROR;
+}
+
+
+//******************************************************************************
+int MAX17055::avg_ta(int *value)
+{
+    return read<MAX17055::AVG_TA>(value);
+}
+
+//******************************************************************************
+int MAX17055::avg_ta(float *value)
+{
+    int ta;
+
+    if (avg_ta(&ta)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = ta * (1.0f / 256);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_temp(int *max, int *min)
+{
+    char buf[2];
+
+    if (readReg(MAX17055::MAX_MIN_TEMP, buf, 2)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = (signed char)buf[1];
+    *min = (signed char)buf[0];
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::max_min_temp(float *max, float *min)
+{
+    int t_max, t_min;
+
+    if (max_min_temp(&t_max, &t_min)) {
+        return MAX17055_ERROR;
+    }
+
+    *max = t_max;
+    *min = t_min;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::set_v_alrt_th(int max, int min)
+{
+    return writeReg(MAX17055::V_ALRT_TH, (uint16_t)(((max & 0xFF) << 8) |
+                                                    (min & 0xFF)));
+}
+
+//******************************************************************************
+int MAX17055::set_v_alrt_th(float max, float min)
+{
+    return set_v_alrt_th(clampInt(roundInt(max * 50), 0, 255),
+                         clampInt(roundInt(min * 50), 0, 255));
+}
+
+//******************************************************************************
+int MAX17055::set_t_alrt_th(int max, int min)
+{
+    return writeReg(MAX17055::T_ALRT_TH, (uint16_t)(((max & 0xFF) << 8) |
+                                                    (min & 0xFF)));
+}
+
+//******************************************************************************
+int MAX17055::set_t_alrt_th(float max, float min)
+{
+    return set_t_alrt_th(clampInt(roundInt(max), -128, 127),
+                         clampInt(roundInt(min), -128, 127));
+}
+
+//******************************************************************************
+int MAX17055::set_s_alrt_th(int max, int min)
+{
+    return writeReg(MAX17055::S_ALRT_TH, (uint16_t)(((max & 0xFF) << 8) |
+                                                    (min & 0xFF)));
+}
+
+//******************************************************************************
+int MAX17055::set_s_alrt_th(float max, float min)
+{
+    return set_s_alrt_th(clampInt(roundInt(max), 0, 255),
+                         clampInt(roundInt(min), 0, 255));
+}
+
+//******************************************************************************
+int MAX17055::set_i_alrt_th(int max, int min)
+{
+    return writeReg(MAX17055::I_ALRT_TH, (uint16_t)(((max & 0xFF) << 8) |
+                                                    (min & 0xFF)));
+}
+
+//******************************************************************************
+int MAX17055::set_i_alrt_th(float max, float min)
+{
+    // i_min_max_lsb is in amps, the thresholds in milliamps
+    float lsb_ma = i_min_max_lsb * 1000.0f;
+
+    return set_i_alrt_th(clampInt(roundInt(max / lsb_ma), -128, 127),
+                         clampInt(roundInt(min / lsb_ma), -128, 127));
+}
+
+//******************************************************************************
+int MAX17055::enable_alerts(bool aen, bool dsocen)
+{
+    if (updateReg(MAX17055::CONFIG, MAX17055_CONFIG_AEN,
+                  aen ? MAX17055_CONFIG_AEN : 0)) {
+        return MAX17055_ERROR;
+    }
+
+    return updateReg(MAX17055::CONFIG2, MAX17055_CONFIG2_DSOCEN,
+                     dsocen ? MAX17055_CONFIG2_DSOCEN : 0);
+}
+
+#if DEVICE_INTERRUPTIN
+//******************************************************************************
+void MAX17055::attach_alert(InterruptIn &alrt, EventQueue *queue)
+{
+    alert_queue = queue;
+    alrt.fall(callback(this, &MAX17055::alertIrq));
+}
+
+//******************************************************************************
+int MAX17055::on_alert(alert_t event, Callback<void(int)> cb)
+{
+    if ((event < 0) || (event >= ALERT_NUM)) {
+        return MAX17055_ERROR;
+    }
+
+    alert_cb[event] = cb;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+void MAX17055::alertIrq()
+{
+    // Interrupt context, the bus is only touched from the queue
+    alert_queue->call(callback(this, &MAX17055::alertHandler));
+}
+
+//******************************************************************************
+void MAX17055::alertHandler()
+{
+    const uint16_t keep = (1 << ALERT_POR) | (1 << ALERT_BST);
+    int status;
+    int bit;
+
+    if (readReg16(MAX17055::STATUS, &status)) {
+        return;
+    }
+
+    // Clearing the alert bits releases ALRT
+    if (status & ~keep) {
+        if (writeReg(MAX17055::STATUS, (uint16_t)(status & keep))) {
+            return;
+        }
+    }
+
+    for (bit = 0; bit < ALERT_NUM; bit++) {
+        if ((status & (1 << bit)) && alert_cb[bit]) {
+            alert_cb[bit](status);
+        }
+    }
 }
+#endif
 
 //******************************************************************************
-int MAX17055::status(int *value)
+int MAX17055::snapshot(snapshot_t *snap)
 {
-    char buf[2];
+    snap->valid = false;
+    snap->i_lsb = i_lsb;
+    snap->i_min_max_lsb = i_min_max_lsb;
+    snap->i_scale = i_scale;
+
+    if (readRegs(MAX17055::STATUS, snap->regs, MAX17055_SNAPSHOT_REGS)) {
+        return MAX17055_ERROR;
+    }
 
-    if (readReg(MAX17055::STATUS, buf, 2)) {
+    if (readRegs(MAX17055::STATUS_2, snap->regs_2, MAX17055_SNAPSHOT_2_REGS)) {
         return MAX17055_ERROR;
     }
 
-    *value = (unsigned int)((buf[1] << 8) | buf[0]);
+    snap->valid = true;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::v_cell(int *value)
+int MAX17055::snapshot_t::reg(reg_t reg, int *value) const
 {
-    char buf[2];
-
-    if (readReg(MAX17055::V_CELL, buf, 2)) {
+    if (!valid) {
         return MAX17055_ERROR;
     }
 
-    *value = (unsigned int)((buf[1] << 8) | buf[0]);
+    if (reg < MAX17055_SNAPSHOT_REGS) {
+        *value = regs[reg];
+    } else if ((reg >= MAX17055::STATUS_2) &&
+               (reg < MAX17055::STATUS_2 + MAX17055_SNAPSHOT_2_REGS)) {
+        *value = regs_2[reg - MAX17055::STATUS_2];
+    } else {
+        return MAX17055_ERROR;
+    }
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::v_cell(float *value)
+int MAX17055::snapshot_t::status(int *value) const
+{
+    return reg(MAX17055::STATUS, value);
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::v_cell(int *value) const
+{
+    return reg(MAX17055::V_CELL, value);
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::v_cell(float *value) const
 {
     int v;
 
@@ -96,21 +1031,13 @@ int MAX17055::v_cell(float *value)
 }
 
 //******************************************************************************
-int MAX17055::avg_v_cell(int *value)
+int MAX17055::snapshot_t::avg_v_cell(int *value) const
 {
-    char buf[2];
-
-    if (readReg(MAX17055::AVG_V_CELL, buf, 2)) {
-        return MAX17055_ERROR;
-    }
-
-    *value = (unsigned int)((buf[1] << 8) | buf[0]);
-
-    return MAX17055_NO_ERROR;
+    return reg(MAX17055::AVG_V_CELL, value);
 }
 
 //******************************************************************************
-int MAX17055::avg_v_cell(float *value)
+int MAX17055::snapshot_t::avg_v_cell(float *value) const
 {
     int avc;
 
@@ -124,22 +1051,22 @@ int MAX17055::avg_v_cell(float *value)
 }
 
 //******************************************************************************
-int MAX17055::max_min_volt(int *max, int *min)
+int MAX17055::snapshot_t::max_min_volt(int *max, int *min) const
 {
-    char buf[2];
+    int v;
 
-    if (readReg(MAX17055::MAX_MIN_VOLT, buf, 2)) {
+    if (reg(MAX17055::MAX_MIN_VOLT, &v)) {
         return MAX17055_ERROR;
     }
 
-    *max = (unsigned char)buf[1];
-    *min = (unsigned char)buf[0];
+    *max = (unsigned char)(v >> 8);
+    *min = (unsigned char)v;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::max_min_volt(float *max, float *min)
+int MAX17055::snapshot_t::max_min_volt(float *max, float *min) const
 {
     int v_max, v_min;
 
@@ -154,21 +1081,21 @@ int MAX17055::max_min_volt(float *max, float *min)
 }
 
 //******************************************************************************
-int MAX17055::current(int *value)
+int MAX17055::snapshot_t::current(int *value) const
 {
-    char buf[2];
+    int i;
 
-    if (readReg(MAX17055::CURRENT, buf, 2)) {
+    if (reg(MAX17055::CURRENT, &i)) {
         return MAX17055_ERROR;
     }
 
-    *value = (short int)((buf[1] << 8) | buf[0]);
+    *value = (short int)i;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::current(float *value)
+int MAX17055::snapshot_t::current(float *value) const
 {
     int i;
 
@@ -182,21 +1109,21 @@ int MAX17055::current(float *value)
 }
 
 //******************************************************************************
-int MAX17055::avg_current(int *value)
+int MAX17055::snapshot_t::avg_current(int *value) const
 {
-    char buf[2];
+    int i_a;
 
-    if (readReg(MAX17055::AVG_CURRENT, buf, 2)) {
+    if (reg(MAX17055::AVG_CURRENT, &i_a)) {
         return MAX17055_ERROR;
     }
 
-    *value = (short int)((buf[1] << 8) | buf[0]);
+    *value = (short int)i_a;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::avg_current(float *value)
+int MAX17055::snapshot_t::avg_current(float *value) const
 {
     int i_a;
 
@@ -210,22 +1137,22 @@ int MAX17055::avg_current(float *value)
 }
 
 //******************************************************************************
-int MAX17055::max_min_curr(int *max, int *min)
+int MAX17055::snapshot_t::max_min_curr(int *max, int *min) const
 {
-    char buf[2];
+    int i;
 
-    if (readReg(MAX17055::MAX_MIN_CURR, buf, 2)) {
+    if (reg(MAX17055::MAX_MIN_CURR, &i)) {
         return MAX17055_ERROR;
     }
 
-    *max = (signed char)buf[1];
-    *min = (signed char)buf[0];
+    *max = (signed char)(i >> 8);
+    *min = (signed char)i;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::max_min_curr(float *max, float *min)
+int MAX17055::snapshot_t::max_min_curr(float *max, float *min) const
 {
     int i_max, i_min;
 
@@ -240,21 +1167,21 @@ int MAX17055::max_min_curr(float *max, float *min)
 }
 
 //******************************************************************************
-int MAX17055::temp(int *value)
+int MAX17055::snapshot_t::temp(int *value) const
 {
-    char buf[2];
+    int t;
 
-    if (readReg(MAX17055::TEMP, buf, 2)) {
+    if (reg(MAX17055::TEMP, &t)) {
         return MAX17055_ERROR;
     }
 
-    *value = (short int)((buf[1] << 8) | buf[0]);
+    *value = (short int)t;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::temp(float *value)
+int MAX17055::snapshot_t::temp(float *value) const
 {
     int t;
 
@@ -267,23 +1194,22 @@ int MAX17055::temp(float *value)
     return MAX17055_NO_ERROR;
 }
 
-
 //******************************************************************************
-int MAX17055::avg_ta(int *value)
+int MAX17055::snapshot_t::avg_ta(int *value) const
 {
-    char buf[2];
+    int ta;
 
-    if (readReg(MAX17055::AVG_TA, buf, 2)) {
+    if (reg(MAX17055::AVG_TA, &ta)) {
         return MAX17055_ERROR;
     }
 
-    *value = (short int)((buf[1] << 8) | buf[0]);
+    *value = (short int)ta;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::avg_ta(float *value)
+int MAX17055::snapshot_t::avg_ta(float *value) const
 {
     int ta;
 
@@ -297,22 +1223,22 @@ int MAX17055::avg_ta(float *value)
 }
 
 //******************************************************************************
-int MAX17055::max_min_temp(int *max, int *min)
+int MAX17055::snapshot_t::max_min_temp(int *max, int *min) const
 {
-    char buf[2];
+    int t;
 
-    if (readReg(MAX17055::MAX_MIN_TEMP, buf, 2)) {
+    if (reg(MAX17055::MAX_MIN_TEMP, &t)) {
         return MAX17055_ERROR;
     }
 
-    *max = (signed char)buf[1];
-    *min = (signed char)buf[0];
+    *max = (signed char)(t >> 8);
+    *min = (signed char)t;
 
     return MAX17055_NO_ERROR;
 }
 
 //******************************************************************************
-int MAX17055::max_min_temp(float *max, float *min)
+int MAX17055::snapshot_t::max_min_temp(float *max, float *min) const
 {
     int t_max, t_min;
 
@@ -326,12 +1252,96 @@ int MAX17055::max_min_temp(float *max, float *min)
     return MAX17055_NO_ERROR;
 }
 
+//******************************************************************************
+int MAX17055::snapshot_t::v_cell_uv(int32_t *value) const
+{
+    int v;
+
+    if (v_cell(&v)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = uvFromVCell(v);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::avg_v_cell_uv(int32_t *value) const
+{
+    int avc;
+
+    if (avg_v_cell(&avc)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = uvFromVCell(avc);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::current_ua(int32_t *value) const
+{
+    int i;
+
+    if (current(&i)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = scaleQ16(i, i_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::avg_current_ua(int32_t *value) const
+{
+    int i_a;
+
+    if (avg_current(&i_a)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = scaleQ16(i_a, i_scale);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::temp_mc(int32_t *value) const
+{
+    int t;
+
+    if (temp(&t)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = mcFromTemp(t);
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::snapshot_t::avg_ta_mc(int32_t *value) const
+{
+    int ta;
+
+    if (avg_ta(&ta)) {
+        return MAX17055_ERROR;
+    }
+
+    *value = mcFromTemp(ta);
+
+    return MAX17055_NO_ERROR;
+}
+
 //******************************************************************************
 int MAX17055::writeReg(reg_t reg, char value, bool verify)
 {
     char buf[] = { (char)reg, value };
 
-    if (i2c.write(addr, buf, sizeof(buf))) {
+    if (transport.write(addr, buf, sizeof(buf))) {
         return MAX17055_ERROR;
     }
 
@@ -352,13 +1362,13 @@ int MAX17055::writeReg(reg_t reg, uint16_t value, bool verify)
     attempt = 0;
 
     do {
-        if (i2c.write(addr, wbuf, 3)) return MAX17055_ERROR;
+        if (transport.write(addr, wbuf, 3)) return MAX17055_ERROR;
 
         if (!verify) break;
 
-        Thread::wait(1);
+        transport.delay_ms(1);
 
-        if (i2c.read(addr, rbuf, 2)) return MAX17055_ERROR;
+        if (transport.writeRead(addr, wbuf, 1, rbuf, 2)) return MAX17055_ERROR;
 
     } while ((((rbuf[1] << 8) | rbuf[0]) != value) && (attempt++ < 3));
 
@@ -367,34 +1377,302 @@ int MAX17055::writeReg(reg_t reg, uint16_t value, bool verify)
     return MAX17055_NO_ERROR;
 }
 
+//******************************************************************************
+int MAX17055::updateReg(reg_t reg, uint16_t mask, uint16_t value)
+{
+    int old;
+
+    if (readReg16(reg, &old)) {
+        return MAX17055_ERROR;
+    }
+
+    return writeReg(reg, (uint16_t)((old & ~mask) | (value & mask)));
+}
+
+//******************************************************************************
+int MAX17055::writeRegs(const reg_write_t *writes, int count)
+{
+    bool ok;
+    int attempt;
+    int i;
+
+    if ((count <= 0) || (count > 16)) {
+        return MAX17055_ERROR;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (writeReg(writes[i].reg, writes[i].value)) {
+            return MAX17055_ERROR;
+        }
+    }
+
+    for (attempt = 0; attempt < 3; attempt++) {
+        if (verifyRegs(writes, count, &ok)) {
+            return MAX17055_ERROR;
+        }
+
+        if (ok) {
+            return MAX17055_NO_ERROR;
+        }
+    }
+
+    return MAX17055_ERROR;
+}
+
+//******************************************************************************
+// Reads the written registers back, one burst per MAX17055_VERIFY_SPAN
+// window, and rewrites the ones that differ
+int MAX17055::verifyRegs(const reg_write_t *writes, int count, bool *ok)
+{
+    uint16_t buf[MAX17055_VERIFY_SPAN];
+    bool checked[16] = { false };
+    int base, last;
+    int i, j;
+
+    *ok = true;
+
+    for (i = 0; i < count; i++) {
+        if (checked[i]) {
+            continue;
+        }
+
+        // One burst from this register up to the last one in reach
+        base = writes[i].reg;
+        last = base;
+        for (j = i + 1; j < count; j++) {
+            if (!checked[j] && (writes[j].reg > last) &&
+                (writes[j].reg < base + MAX17055_VERIFY_SPAN)) {
+                last = writes[j].reg;
+            }
+        }
+
+        if (readRegs((reg_t)base, buf, last - base + 1)) {
+            return MAX17055_ERROR;
+        }
+
+        for (j = i; j < count; j++) {
+            if (checked[j] || (writes[j].reg < base) ||
+                (writes[j].reg > last)) {
+                continue;
+            }
+
+            checked[j] = true;
+
+            if (buf[writes[j].reg - base] != writes[j].value) {
+                *ok = false;
+                if (writeReg(writes[j].reg, writes[j].value)) {
+                    return MAX17055_ERROR;
+                }
+            }
+        }
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::writeBlock(reg_t reg, const uint16_t *value, int count)
+{
+    char buf[1 + 2 * MAX17055_MODEL_WORDS];
+    int i;
+
+    if ((count <= 0) || (count > MAX17055_MODEL_WORDS)) {
+        return MAX17055_ERROR;
+    }
+
+    buf[0] = reg;
+    for (i = 0; i < count; i++) {
+        buf[1 + 2 * i] = value[i];
+        buf[2 + 2 * i] = value[i] >> 8;
+    }
+
+    if (transport.write(addr, buf, 1 + 2 * count)) {
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
 //******************************************************************************
 int MAX17055::readReg(reg_t reg, char *value)
 {
     char buf[] = { (char)reg };
 
-    if (i2c.write(addr, buf, sizeof(buf))) {
+    if (transport.writeRead(addr, buf, sizeof(buf), value, 1)) {
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::readReg(reg_t reg, char *buf, int len)
+{
+    char tx = (char)reg;
+
+    if (transport.writeRead(addr, &tx, 1, buf, len)) {
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::readReg16(reg_t reg, int *value)
+{
+    char buf[2];
+
+    if (readReg(reg, buf, 2)) {
         return MAX17055_ERROR;
     }
 
-    if (i2c.read(addr, value, 1)) {
+    *value = ((unsigned char)buf[1] << 8) | (unsigned char)buf[0];
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055::readRegs(reg_t reg, uint16_t *value, int count)
+{
+    if (readReg(reg, (char *)value, count * 2)) {
         return MAX17055_ERROR;
     }
 
+    decodeRegs(value, count);
+
     return MAX17055_NO_ERROR;
 }
 
+#if DEVICE_I2C_ASYNCH
 //******************************************************************************
-int MAX17055::readReg(reg_t reg, char *buf, int len)
+int MAX17055::snapshotAsync(snapshot_t *snap, EventQueue *queue,
+                            Callback<void(int)> done)
 {
-    *buf = (char)reg;
+    if (async_op != ASYNC_IDLE) {
+        return MAX17055_ERROR;
+    }
+
+    snap->valid = false;
+    snap->i_lsb = i_lsb;
+    snap->i_min_max_lsb = i_min_max_lsb;
+    snap->i_scale = i_scale;
+
+    async_queue = queue;
+    async_done = done;
+    async_snap = snap;
+    async_op = ASYNC_SNAPSHOT;
+
+    if (asyncTransfer()) {
+        async_op = ASYNC_IDLE;
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
 
-    if (i2c.write(addr, buf, 1)) {
+//******************************************************************************
+int MAX17055::writeRegsAsync(const reg_write_t *writes, int count,
+                             EventQueue *queue, Callback<void(int)> done)
+{
+    if ((async_op != ASYNC_IDLE) || (count <= 0)) {
         return MAX17055_ERROR;
     }
 
-    if (i2c.read(addr, buf, len)) {
+    async_queue = queue;
+    async_done = done;
+    async_writes = writes;
+    async_count = count;
+    async_index = 0;
+    async_op = ASYNC_WRITES;
+
+    if (asyncTransfer()) {
+        async_op = ASYNC_IDLE;
         return MAX17055_ERROR;
     }
 
     return MAX17055_NO_ERROR;
 }
+
+//******************************************************************************
+int MAX17055::asyncTransfer()
+{
+    event_callback_t event = callback(this, &MAX17055::asyncEvent);
+    const reg_write_t *w;
+
+    switch (async_op) {
+        case ASYNC_SNAPSHOT:
+            async_buf[0] = MAX17055::STATUS;
+            return transport.writeReadAsync(addr, async_buf, 1,
+                                            (char *)async_snap->regs,
+                                            sizeof(async_snap->regs), event);
+        case ASYNC_SNAPSHOT_2:
+            async_buf[0] = MAX17055::STATUS_2;
+            return transport.writeReadAsync(addr, async_buf, 1,
+                                            (char *)async_snap->regs_2,
+                                            sizeof(async_snap->regs_2),
+                                            event);
+        case ASYNC_WRITES:
+            w = &async_writes[async_index];
+            async_buf[0] = w->reg;
+            async_buf[1] = w->value;
+            async_buf[2] = w->value >> 8;
+            return transport.writeReadAsync(addr, async_buf, 3, NULL, 0,
+                                            event);
+        default:
+            return MAX17055_ERROR;
+    }
+}
+
+//******************************************************************************
+void MAX17055::asyncEvent(int event)
+{
+    // Interrupt context, where writeReadAsync() must not be called
+    async_queue->call(callback(this, &MAX17055::asyncStep), event);
+}
+
+//******************************************************************************
+void MAX17055::asyncStep(int event)
+{
+    if (event & (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE |
+                 I2C_EVENT_TRANSFER_EARLY_NACK)) {
+        asyncFinish(MAX17055_ERROR);
+        return;
+    }
+
+    switch (async_op) {
+        case ASYNC_SNAPSHOT:
+            async_op = ASYNC_SNAPSHOT_2;
+            break;
+        case ASYNC_SNAPSHOT_2:
+            decodeRegs(async_snap->regs, MAX17055_SNAPSHOT_REGS);
+            decodeRegs(async_snap->regs_2, MAX17055_SNAPSHOT_2_REGS);
+            async_snap->valid = true;
+            asyncFinish(MAX17055_NO_ERROR);
+            return;
+        case ASYNC_WRITES:
+            if (++async_index == async_count) {
+                asyncFinish(MAX17055_NO_ERROR);
+                return;
+            }
+            break;
+        default:
+            return;
+    }
+
+    if (asyncTransfer()) {
+        asyncFinish(MAX17055_ERROR);
+    }
+}
+
+//******************************************************************************
+void MAX17055::asyncFinish(int result)
+{
+    Callback<void(int)> done = async_done;
+
+    async_op = ASYNC_IDLE;
+
+    if (done) {
+        done(result);
+    }
+}
+#endif
@@ -34,7 +34,14 @@
 #ifndef _MAX17055_H_
 #define _MAX17055_H_
 
+#ifdef __MBED__
 #include "mbed.h"
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#endif
+#include "MAX17055Transport.h"
 
 #define MAX17055_I2C_ADDRESS   0x6C
 
@@ -46,6 +53,54 @@
 #define MAX17055_I_LSB_UV         1.5625E-3f
 #define MAX17055_I_MAX_MIN_LSB_MV 0.0004f
 
+// Integer scaling: VCell LSB is 625/8 uV, Temp LSB is 125/32 m°C, and the
+// uA and uAh per LSB in Q16 are these divided by r_sense in micro-ohms
+#define MAX17055_V_LSB_UV_NUM     625
+#define MAX17055_V_LSB_UV_SHIFT   3
+#define MAX17055_V_MAX_MIN_LSB_UV 20000
+#define MAX17055_T_LSB_MC_NUM     125
+#define MAX17055_T_LSB_MC_SHIFT   5
+#define MAX17055_I_Q16_NUM        102400000000ULL  // 1.5625 uV << 16
+#define MAX17055_CAP_Q16_NUM      327680000000ULL  // 5.0 uVh << 16
+
+#define MAX17055_STATUS_POR       (1 << 1)
+#define MAX17055_FSTAT_DNR        (1 << 0)
+#define MAX17055_MODELCFG_REFRESH (1 << 15)
+#define MAX17055_MODELCFG_VCHG    (1 << 10)
+#define MAX17055_CMD_SOFT_WAKEUP  0x0090
+#define MAX17055_MODEL_UNLOCK1    0x0059
+#define MAX17055_MODEL_UNLOCK2    0x00C4
+#define MAX17055_MODEL_WORDS      48    // MODEL_DATA .. 0xAF
+#define MAX17055_POLL_MS          10
+#define MAX17055_POLL_TRIES       100   // 1s
+#define MAX17055_VERIFY_SPAN      0x40  // widest single burst read-back
+
+#define MAX17055_CONFIG_AEN       (1 << 2)
+#define MAX17055_CONFIG2_DSOCEN   (1 << 7)
+
+// Threshold values that never trigger
+#define MAX17055_V_ALRT_TH_DISABLED 0xFF00
+#define MAX17055_T_ALRT_TH_DISABLED 0x7F80
+#define MAX17055_S_ALRT_TH_DISABLED 0xFF00
+#define MAX17055_I_ALRT_TH_DISABLED 0x7F80
+
+// Learned parameters are kept in KVStore when the storage feature is there
+#ifndef MAX17055_KVSTORE
+#ifdef MBED_CONF_STORAGE_STORAGE_TYPE
+#define MAX17055_KVSTORE 1
+#else
+#define MAX17055_KVSTORE 0
+#endif
+#endif
+
+#define MAX17055_KV_KEY           "/kv/max17055_learned"
+#define MAX17055_LEARNED_VERSION  1
+#define MAX17055_LEARNED_SIZE     16    // version, 7 registers, CRC-8
+#define MAX17055_LEARNED_CYCLES   0x40  // save every 64% of a cycle
+
+#define MAX17055_SNAPSHOT_REGS    0x21  // STATUS .. TTF
+#define MAX17055_SNAPSHOT_2_REGS  4     // STATUS_2 .. AVG_POWER
+
 /**
  * @brief MAX17055 7µA 1-Cell Fuel Gauge with ModelGauge m5 EZ
  *
@@ -55,6 +110,9 @@
  * requirements and simplifying host software interaction.
  * The ModelGauge m5 EZ robust algorithm provides tolerance against battery
  * diversity for most lithium batteries and applications.
+ * Bus access goes through a MAX17055Transport, so the same driver runs on
+ * mbed I2C, Linux i2c-dev (MAX17055LinuxTransport) or the register
+ * simulator (MAX17055SimTransport).
  * <br>https://www.maximintegrated.com/en/products/power/battery-management/MAX17055.html
  *
  * @code
@@ -164,6 +222,10 @@ public:
         CONVG_CFG = 0x49,
         VF_REM_CAP,
         QH = 0x4D,
+        COMMAND = 0x60,
+        MODEL_LOCK1 = 0x62,
+        MODEL_LOCK2,
+        MODEL_DATA = 0x80,
         STATUS_2 = 0xB0,
         POWER,
         ID_USER_MEM2,
@@ -196,6 +258,204 @@ public:
         AT_AV_CA
     } reg_t;
 
+    /**
+     * @brief   Alert Events
+     * @details Status register bit of each alert event
+     */
+    typedef enum {
+        ALERT_POR = 1,
+        ALERT_IMN = 2,
+        ALERT_BST = 3,
+        ALERT_IMX = 6,
+        ALERT_DSOCI = 7,
+        ALERT_VMN = 8,
+        ALERT_TMN = 9,
+        ALERT_SMN = 10,
+        ALERT_BI = 11,
+        ALERT_VMX = 12,
+        ALERT_TMX = 13,
+        ALERT_SMX = 14,
+        ALERT_BR = 15,
+        ALERT_NUM = 16
+    } alert_t;
+
+    /**
+     * @brief   Register Units
+     * @details Units of the values returned by the float read<>()
+     */
+    typedef enum {
+        UNIT_RAW,
+        UNIT_VOLT,
+        UNIT_MILLIAMP,
+        UNIT_MILLIAMP_HOUR,
+        UNIT_PERCENT,
+        UNIT_DEG_C,
+        UNIT_SECOND,
+        UNIT_MILLIWATT,
+        UNIT_OHM,
+        UNIT_CYCLE
+    } unit_t;
+
+    /**
+     * @brief   Register Formats
+     * @details Signedness, LSB and unit shared by a class of registers.
+     * Formats with sense set scale with 1 / r_sense.
+     */
+    template <bool Signed, bool Sense, unit_t Unit>
+    struct reg_fmt_t {
+        static constexpr bool is_signed = Signed;
+        static constexpr bool sense = Sense;
+        static constexpr unit_t unit = Unit;
+
+        static constexpr int decode(int raw)
+        {
+            return Signed ? (int)(int16_t)(uint16_t)raw : (raw & 0xFFFF);
+        }
+
+        static constexpr uint16_t encode(int value)
+        {
+            return Signed ?
+                   (uint16_t)(value > 32767 ? 32767 :
+                              value < -32768 ? -32768 : value) :
+                   (uint16_t)(value > 65535 ? 65535 :
+                              value < 0 ? 0 : value);
+        }
+    };
+
+    struct fmt_raw : reg_fmt_t<false, false, UNIT_RAW> {
+        static constexpr float lsb() { return 1.0f; }
+    };
+    struct fmt_voltage : reg_fmt_t<false, false, UNIT_VOLT> {
+        static constexpr float lsb() { return MAX17055_V_LSB_MV; }
+    };
+    struct fmt_current : reg_fmt_t<true, true, UNIT_MILLIAMP> {
+        static constexpr float lsb() { return MAX17055_I_LSB_UV; }
+    };
+    struct fmt_capacity : reg_fmt_t<false, true, UNIT_MILLIAMP_HOUR> {
+        static constexpr float lsb() { return 5.0E-3f; }
+    };
+    struct fmt_percent : reg_fmt_t<false, false, UNIT_PERCENT> {
+        static constexpr float lsb() { return 1.0f / 256; }
+    };
+    struct fmt_temp : reg_fmt_t<true, false, UNIT_DEG_C> {
+        static constexpr float lsb() { return 1.0f / 256; }
+    };
+    struct fmt_time : reg_fmt_t<false, false, UNIT_SECOND> {
+        static constexpr float lsb() { return 5.625f; }
+    };
+    struct fmt_power : reg_fmt_t<true, true, UNIT_MILLIWATT> {
+        static constexpr float lsb() { return 8.0E-3f; }
+    };
+    struct fmt_resistance : reg_fmt_t<false, false, UNIT_OHM> {
+        static constexpr float lsb() { return 1.0f / 4096; }
+    };
+    struct fmt_cycles : reg_fmt_t<false, false, UNIT_CYCLE> {
+        static constexpr float lsb() { return 0.01f; }
+    };
+
+    /**
+     * @brief   Register Descriptor
+     * @details Format of register R. Registers without a numeric value
+     * (configuration, packed thresholds, model data) read as raw; the
+     * measurement registers are specialized after the class.
+     */
+    template <reg_t R>
+    struct reg_desc : fmt_raw {
+        static constexpr reg_t addr = R;
+    };
+
+    /**
+     * @brief   Register Snapshot
+     * @details Copy of the live measurement registers, read in two bursts
+     * by snapshot(). The accessors decode from memory and never touch the
+     * bus; they fail only if the snapshot could not be read.
+     */
+    struct snapshot_t {
+        uint16_t regs[MAX17055_SNAPSHOT_REGS];      // STATUS .. TTF
+        uint16_t regs_2[MAX17055_SNAPSHOT_2_REGS];  // STATUS_2 .. AVG_POWER
+        float i_lsb;
+        float i_min_max_lsb;
+        uint32_t i_scale;
+        bool valid;
+
+        /**
+         * @brief   Raw register value
+         * @param   reg The register, must be within the snapshot
+         * @param   value The location to store value
+         * @returns 0 if no errors, -1 if error
+         */
+        int reg(reg_t reg, int *value) const;
+
+        int status(int *value) const;
+        int v_cell(int *value) const;
+        int v_cell(float *value) const;
+        int avg_v_cell(int *value) const;
+        int avg_v_cell(float *value) const;
+        int max_min_volt(int *max, int *min) const;
+        int max_min_volt(float *max, float *min) const;
+        int current(int *value) const;
+        int current(float *value) const;
+        int avg_current(int *value) const;
+        int avg_current(float *value) const;
+        int max_min_curr(int *max, int *min) const;
+        int max_min_curr(float *max, float *min) const;
+        int temp(int *value) const;
+        int temp(float *value) const;
+        int avg_ta(int *value) const;
+        int avg_ta(float *value) const;
+        int max_min_temp(int *max, int *min) const;
+        int max_min_temp(float *max, float *min) const;
+        int v_cell_uv(int32_t *value) const;
+        int avg_v_cell_uv(int32_t *value) const;
+        int current_ua(int32_t *value) const;
+        int avg_current_ua(int32_t *value) const;
+        int temp_mc(int32_t *value) const;
+        int avg_ta_mc(int32_t *value) const;
+    };
+
+    /**
+     * @brief   Register Write
+     * @details One entry of a register write chain
+     */
+    struct reg_write_t {
+        reg_t reg;
+        uint16_t value;
+    };
+
+    /**
+     * @brief   EZ Configuration
+     * @details Battery parameters written after POR, as raw register
+     * values. dQAcc, dPAcc and ModelCfg are derived from them.
+     */
+    struct ez_config_t {
+        uint16_t design_cap;    // DesignCap, 5.0uVh / r_sense LSB
+        uint16_t i_chg_term;    // IChgTerm, 1.5625uV / r_sense LSB
+        uint16_t v_empty;       // VEmpty, VE 10mV [15:7], VR 40mV [6:0]
+        bool high_charge_voltage;   // charge voltage above 4.275V
+    };
+
+    /**
+     * @brief   Custom Model
+     * @details Characterization data loaded instead of the EZ model
+     */
+    struct custom_model_t {
+        uint16_t data[MAX17055_MODEL_WORDS];    // MODEL_DATA .. 0xAF
+        uint16_t r_comp0;
+        uint16_t temp_co;
+        uint16_t qr_table[4];   // QRTable00, 10, 20, 30
+        uint16_t model_cfg;     // ModelCfg without Refresh
+    };
+
+    /**
+     * MAX17055 constructor
+     *
+     * @param transport Bus transport to use.
+     * @param address Slave Address of the device.
+     */
+    MAX17055(MAX17055Transport &transport,
+             int address = MAX17055_I2C_ADDRESS);
+
+#ifdef __MBED__
     /**
      * MAX17055 constructor
      *
@@ -203,6 +463,7 @@ public:
      * @param address Slave Address of the device.
      */
     MAX17055(I2C &i2c, int address = MAX17055_I2C_ADDRESS);
+#endif
 
     /**
      * MAX17055 destructor
@@ -217,6 +478,75 @@ public:
      */
     void init(float r_sense);
 
+    /**
+     * @brief   Initialize driver state without floating point
+     * @details Initialize the integer API with the supplied sense resistor
+     * value. The float accessors still require init(float).
+     * @param   r_sense_uohm The sense resistor value in micro-ohms
+     * @returns 0 if no errors, -1 if r_sense_uohm is 0
+     */
+    int init_uohm(uint32_t r_sense_uohm);
+
+    /**
+     * @brief   Initialize driver and gauge
+     * @details Initializes driver state like init(float), then checks
+     * Status.POR. After a POR it waits for the gauge to finish its startup
+     * measurements, wakes it from hibernate, writes the EZ parameters (or
+     * loads the custom model) and verifies them with burst read-backs,
+     * waits for the model refresh, restores HibCfg and clears POR. Without
+     * a POR the gauge is left as it is.
+     * @param   r_sense The sense resistor value in ohms
+     * @param   cfg EZ battery parameters
+     * @param   model Custom model to load, or NULL for the EZ model
+     * @returns 0 if no errors, -1 if error or cfg.design_cap is 0
+     */
+    int init(float r_sense, const ez_config_t &cfg,
+             const custom_model_t *model = NULL);
+
+    /**
+     * @brief   Initialize driver and gauge without floating point
+     * @details Like init(float, cfg, model), but initializes driver state
+     * like init_uohm(), so targets without an FPU can handle a POR
+     * without pulling in float code.
+     * @param   r_sense_uohm The sense resistor value in micro-ohms
+     * @param   cfg EZ battery parameters
+     * @param   model Custom model to load, or NULL for the EZ model
+     * @returns 0 if no errors, -1 if error, r_sense_uohm is 0 or
+     * cfg.design_cap is 0
+     */
+    int init_uohm(uint32_t r_sense_uohm, const ez_config_t &cfg,
+                  const custom_model_t *model = NULL);
+
+#if MAX17055_KVSTORE
+    /**
+     * @brief   Save learned parameters
+     * @details Stores RComp0, TempCo, FullCapRep, FullCapNom, Cycles,
+     * dQAcc and dPAcc in KVStore. To spare the flash the blob is only
+     * rewritten when RComp0 or TempCo changed, a capacity moved by more
+     * than 1%, or Cycles advanced by 64% of a cycle since the last save.
+     * Call it periodically; init() restores the blob after a POR.
+     * @param   force Write even if nothing changed significantly
+     * @returns 0 if no errors, -1 if error
+     */
+    int saveLearned(bool force = false);
+
+    /**
+     * @brief   Restore learned parameters
+     * @details Writes the parameters saved by saveLearned() back to the
+     * gauge, following the datasheet restore sequence.
+     * @returns 0 if no errors, -1 if error or nothing was saved
+     */
+    int restoreLearned();
+
+    /**
+     * @brief   Set KVStore key
+     * @details Sets the key learned parameters are saved under, so that
+     * several gauges can share a KVStore.
+     * @param   key The key, must stay valid
+     */
+    void setLearnedKey(const char *key) { kv_key = key; }
+#endif
+
     /**
      * @brief   Read status register
      * @details Read status register.
@@ -391,6 +721,244 @@ public:
      */
     int max_min_temp(float *max, float *min);
 
+    /**
+     * @brief   Read VCell in microvolts
+     * @details Integer only counterpart of v_cell(float *).
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int v_cell_uv(int32_t *value);
+
+    /**
+     * @brief   Read AvgVCell in microvolts
+     * @details Integer only counterpart of avg_v_cell(float *).
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int avg_v_cell_uv(int32_t *value);
+
+    /**
+     * @brief   Read MaxMinVolt in microvolts
+     * @details Integer only counterpart of max_min_volt(float *, float *).
+     * @param   max The location to store the maximum
+     * @param   min The location to store the minimum
+     * @returns 0 if no errors, -1 if error
+     */
+    int max_min_volt_uv(int32_t *max, int32_t *min);
+
+    /**
+     * @brief   Read Current in microamps
+     * @details Integer only counterpart of current(float *). Requires
+     * init_uohm() or init().
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int current_ua(int32_t *value);
+
+    /**
+     * @brief   Read AvgCurrent in microamps
+     * @details Integer only counterpart of avg_current(float *). Requires
+     * init_uohm() or init().
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int avg_current_ua(int32_t *value);
+
+    /**
+     * @brief   Read MaxMinCurr in microamps
+     * @details Integer only counterpart of max_min_curr(float *, float *).
+     * Requires init_uohm() or init().
+     * @param   max The location to store the maximum
+     * @param   min The location to store the minimum
+     * @returns 0 if no errors, -1 if error
+     */
+    int max_min_curr_ua(int32_t *max, int32_t *min);
+
+    /**
+     * @brief   Read Temp in milli-degrees Celsius
+     * @details Integer only counterpart of temp(float *).
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int temp_mc(int32_t *value);
+
+    /**
+     * @brief   Read AvgTA in milli-degrees Celsius
+     * @details Integer only counterpart of avg_ta(float *).
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int avg_ta_mc(int32_t *value);
+
+    /**
+     * @brief   Read RepCap in microamp-hours
+     * @details The RepCap register reports the remaining capacity.
+     * Requires init_uohm() or init().
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int rep_cap_uah(int32_t *value);
+
+    /**
+     * @brief   Read FullCapRep in microamp-hours
+     * @details The FullCapRep register reports the full capacity.
+     * Requires init_uohm() or init().
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error
+     */
+    int full_cap_rep_uah(int32_t *value);
+
+    /**
+     * @brief   Program voltage alert thresholds
+     * @details Writes VAlrtTh; the ALRT pin asserts when VCell leaves
+     * [min, max]. Raw values have a 20mV LSB.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_v_alrt_th(int max, int min);
+
+    /**
+     * @brief   Program voltage alert thresholds
+     * @details Writes VAlrtTh from thresholds in volts.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_v_alrt_th(float max, float min);
+
+    /**
+     * @brief   Program temperature alert thresholds
+     * @details Writes TAlrtTh; raw values are signed with a 1°C LSB.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_t_alrt_th(int max, int min);
+
+    /**
+     * @brief   Program temperature alert thresholds
+     * @details Writes TAlrtTh from thresholds in degrees Celsius.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_t_alrt_th(float max, float min);
+
+    /**
+     * @brief   Program state of charge alert thresholds
+     * @details Writes SAlrtTh; raw values have a 1% LSB.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_s_alrt_th(int max, int min);
+
+    /**
+     * @brief   Program state of charge alert thresholds
+     * @details Writes SAlrtTh from thresholds in percent.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_s_alrt_th(float max, float min);
+
+    /**
+     * @brief   Program current alert thresholds
+     * @details Writes IAlrtTh; raw values are signed, in MaxMinCurr LSBs.
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_i_alrt_th(int max, int min);
+
+    /**
+     * @brief   Program current alert thresholds
+     * @details Writes IAlrtTh from thresholds in milliamps. Requires
+     * init().
+     * @param   max Upper threshold
+     * @param   min Lower threshold
+     * @returns 0 if no errors, -1 if error
+     */
+    int set_i_alrt_th(float max, float min);
+
+    /**
+     * @brief   Enable alerts
+     * @details Sets or clears Config.Aen, which routes threshold alerts to
+     * the ALRT pin, and Config2.dSOCen, which alerts on every 1% change
+     * of state of charge.
+     * @param   aen Enable threshold alerts
+     * @param   dsocen Enable state of charge change alerts
+     * @returns 0 if no errors, -1 if error
+     */
+    int enable_alerts(bool aen, bool dsocen);
+
+#if DEVICE_INTERRUPTIN
+    /**
+     * @brief   Handle the ALRT pin
+     * @details Attaches to the falling edge of the (active low) ALRT pin.
+     * On each alert the Status register is read and its alert bits are
+     * cleared, then the callback of each reported event runs on queue.
+     * POR and Bst are reported but left set.
+     * @param   alrt The pin the ALRT output is connected to
+     * @param   queue The event queue Status is handled on
+     */
+    void attach_alert(InterruptIn &alrt, EventQueue *queue);
+
+    /**
+     * @brief   Set alert callback
+     * @details Registers the callback run, with the Status value that
+     * reported it, when event fires. An empty callback detaches.
+     * @param   event The alert event
+     * @param   cb The callback
+     * @returns 0 if no errors, -1 if error
+     */
+    int on_alert(alert_t event, Callback<void(int)> cb);
+#endif
+
+    /**
+     * @brief   Read measurement registers
+     * @details Reads STATUS .. TTF and STATUS_2 .. AVG_POWER in two
+     * repeated-start bursts, so that several values can be decoded from
+     * one consistent set of readings with two bus transactions.
+     * @param   snap The location to store the snapshot
+     * @returns 0 if no errors, -1 if error
+     */
+    int snapshot(snapshot_t *snap);
+
+#if DEVICE_I2C_ASYNCH
+    /**
+     * @brief   Read measurement registers asynchronously
+     * @details Same as snapshot(), but returns as soon as the first burst
+     * has been started. The bursts run on
+     * MAX17055Transport::writeReadAsync(), so this fails on transports
+     * without it. done is called from queue with 0 on success or -1 on
+     * error. snap must stay valid until then. Only one asynchronous
+     * operation may be in flight.
+     * @param   snap The location to store the snapshot
+     * @param   queue The event queue done is dispatched on
+     * @param   done Completion callback
+     * @returns 0 if started, -1 if busy or error
+     */
+    int snapshotAsync(snapshot_t *snap, EventQueue *queue,
+                      Callback<void(int)> done);
+
+    /**
+     * @brief   Write registers asynchronously
+     * @details Writes count registers in order, one
+     * MAX17055Transport::writeReadAsync() each, and calls done from queue
+     * with 0 on success or -1 once a write fails. writes must stay valid
+     * until then. Only one asynchronous operation may be in flight.
+     * @param   writes The registers and values to write
+     * @param   count Number of entries in writes
+     * @param   queue The event queue done is dispatched on
+     * @param   done Completion callback
+     * @returns 0 if started, -1 if busy or error
+     */
+    int writeRegsAsync(const reg_write_t *writes, int count,
+                       EventQueue *queue, Callback<void(int)> done);
+#endif
+
     /**
      * @brief   Write 8-Bit Register
      * @details Writes the given value to the specified register.
@@ -411,6 +979,38 @@ public:
      */
     int writeReg(reg_t reg, uint16_t value, bool verify = false);
 
+    /**
+     * @brief   Update 16-Bit Register
+     * @details Read-modify-writes the bits in mask to value.
+     * @param   reg The register to be updated
+     * @param   mask The bits to change
+     * @param   value The new value of the bits in mask
+     * @returns 0 if no errors, -1 if error.
+     */
+    int updateReg(reg_t reg, uint16_t mask, uint16_t value);
+
+    /**
+     * @brief   Write 16-Bit Registers
+     * @details Writes count registers in order, then reads them back in as
+     * few bursts as possible and rewrites any that did not stick, up to
+     * three times.
+     * @param   writes The registers and values to write, at most 16
+     * @param   count Number of entries in writes
+     * @returns 0 if no errors, -1 if error.
+     */
+    int writeRegs(const reg_write_t *writes, int count);
+
+    /**
+     * @brief   Write consecutive 16-Bit Registers
+     * @details Writes count registers starting from the specified register
+     * in a single transaction.
+     * @param   reg The first register to be written
+     * @param   value The data to be written
+     * @param   count Number of registers to write, at most 48
+     * @returns 0 if no errors, -1 if error.
+     */
+    int writeBlock(reg_t reg, const uint16_t *value, int count);
+
     /**
      * @brief   Read 8-Bit Register
      * @details Reads from the specified register
@@ -439,13 +1039,198 @@ public:
      */
     int readReg16(reg_t reg, int *value);
 
+    /**
+     * @brief   Read consecutive 16-Bit Registers
+     * @details Reads count registers starting from the specified register
+     * in a single repeated-start transaction.
+     * @param   reg The first register to be read
+     * @param   value Pointer for where to store the data
+     * @param   count Number of registers to read
+     * @returns 0 if no errors, -1 if error.
+     */
+    int readRegs(reg_t reg, uint16_t *value, int count);
+
+    /**
+     * @brief   Read register R
+     * @details Reads register R and sign extends it if its format is
+     * signed. The decode is resolved at compile time.
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error.
+     */
+    template <reg_t R>
+    int read(int *value)
+    {
+        int raw;
+
+        if (readReg16(R, &raw)) {
+            return MAX17055_ERROR;
+        }
+
+        *value = reg_desc<R>::decode(raw);
+
+        return MAX17055_NO_ERROR;
+    }
+
+    /**
+     * @brief   Read register R in units
+     * @details Reads register R and scales it to reg_desc<R>::unit.
+     * Formats that depend on the sense resistor require init().
+     * @param   value The location to store value read
+     * @returns 0 if no errors, -1 if error.
+     */
+    template <reg_t R>
+    int read(float *value)
+    {
+        int v;
+
+        if (read<R>(&v)) {
+            return MAX17055_ERROR;
+        }
+
+        *value = v * scale<R>();
+
+        return MAX17055_NO_ERROR;
+    }
+
+    /**
+     * @brief   Write register R
+     * @details Writes the raw value, saturated to the register range.
+     * @param   value The value to write
+     * @param   verify Verify data after write
+     * @returns 0 if no errors, -1 if error.
+     */
+    template <reg_t R>
+    int write(int value, bool verify = false)
+    {
+        return writeReg(R, reg_desc<R>::encode(value), verify);
+    }
+
+    /**
+     * @brief   Write register R in units
+     * @details Converts value from reg_desc<R>::unit to the nearest
+     * register value and writes it.
+     * @param   value The value to write
+     * @param   verify Verify data after write
+     * @returns 0 if no errors, -1 if error.
+     */
+    template <reg_t R>
+    int write(float value, bool verify = false)
+    {
+        float raw = value / scale<R>();
+
+        return write<R>((int)(raw < 0 ? raw - 0.5f : raw + 0.5f), verify);
+    }
+
 private:
-    I2C &i2c;
+    template <reg_t R>
+    float scale() const
+    {
+        return reg_desc<R>::sense ? reg_desc<R>::lsb() * r_sense_inv :
+               reg_desc<R>::lsb();
+    }
+
+    int initGauge(const ez_config_t &cfg, const custom_model_t *model);
+    int pollReg(reg_t reg, uint16_t mask);
+    int verifyRegs(const reg_write_t *writes, int count, bool *ok);
+    int loadModel(const custom_model_t &model);
+
+#if DEVICE_I2C_ASYNCH
+    typedef enum {
+        ASYNC_IDLE,
+        ASYNC_SNAPSHOT,
+        ASYNC_SNAPSHOT_2,
+        ASYNC_WRITES
+    } async_op_t;
+
+    int asyncTransfer();
+    void asyncEvent(int event);
+    void asyncStep(int event);
+    void asyncFinish(int result);
+#endif
+
+#if DEVICE_INTERRUPTIN
+    void alertIrq();
+    void alertHandler();
+#endif
+
+#ifdef __MBED__
+    MAX17055MbedTransport mbed_transport;
+#endif
+    MAX17055Transport &transport;
     int addr;
 
     float r_sense;
+    float r_sense_inv;
     float i_lsb;
     float i_min_max_lsb;
+
+    // uA and uAh per LSB in Q16, see init_uohm()
+    uint32_t i_scale;
+    uint32_t cap_scale;
+
+#if DEVICE_I2C_ASYNCH
+    volatile async_op_t async_op;
+    EventQueue *async_queue;
+    Callback<void(int)> async_done;
+    snapshot_t *async_snap;
+    const reg_write_t *async_writes;
+    int async_count;
+    int async_index;
+    char async_buf[3];
+#endif
+
+#if DEVICE_INTERRUPTIN
+    EventQueue *alert_queue;
+    Callback<void(int)> alert_cb[ALERT_NUM];
+#endif
+
+#if MAX17055_KVSTORE
+    const char *kv_key;
+#endif
 };
 
+#define MAX17055_REG_DESC(_reg, _fmt)                                   \
+    template <>                                                         \
+    struct MAX17055::reg_desc<MAX17055::_reg> : MAX17055::_fmt {        \
+        static constexpr MAX17055::reg_t addr = MAX17055::_reg;         \
+    }
+
+MAX17055_REG_DESC(AT_RATE, fmt_current);
+MAX17055_REG_DESC(REP_CAP, fmt_capacity);
+MAX17055_REG_DESC(REP_SOC, fmt_percent);
+MAX17055_REG_DESC(AGE, fmt_percent);
+MAX17055_REG_DESC(TEMP, fmt_temp);
+MAX17055_REG_DESC(V_CELL, fmt_voltage);
+MAX17055_REG_DESC(CURRENT, fmt_current);
+MAX17055_REG_DESC(AVG_CURRENT, fmt_current);
+MAX17055_REG_DESC(Q_RESIDUAL, fmt_capacity);
+MAX17055_REG_DESC(MIX_SOC, fmt_percent);
+MAX17055_REG_DESC(AV_SOC, fmt_percent);
+MAX17055_REG_DESC(MIX_CAP, fmt_capacity);
+MAX17055_REG_DESC(FULL_CAP_REP, fmt_capacity);
+MAX17055_REG_DESC(TTE, fmt_time);
+MAX17055_REG_DESC(FULL_SOC_THR, fmt_percent);
+MAX17055_REG_DESC(R_CELL, fmt_resistance);
+MAX17055_REG_DESC(AVG_TA, fmt_temp);
+MAX17055_REG_DESC(CYCLES, fmt_cycles);
+MAX17055_REG_DESC(DESIGN_CAP, fmt_capacity);
+MAX17055_REG_DESC(AVG_V_CELL, fmt_voltage);
+MAX17055_REG_DESC(I_CHG_TERM, fmt_current);
+MAX17055_REG_DESC(AV_CAP, fmt_capacity);
+MAX17055_REG_DESC(TTF, fmt_time);
+MAX17055_REG_DESC(FULL_CAP_NOM, fmt_capacity);
+MAX17055_REG_DESC(DIE_TEMP, fmt_temp);
+MAX17055_REG_DESC(FULL_CAP, fmt_capacity);
+MAX17055_REG_DESC(VF_REM_CAP, fmt_capacity);
+MAX17055_REG_DESC(POWER, fmt_power);
+MAX17055_REG_DESC(AVG_POWER, fmt_power);
+MAX17055_REG_DESC(MAX_PEAK_POWER, fmt_power);
+MAX17055_REG_DESC(SUS_PEAK_POWER, fmt_power);
+MAX17055_REG_DESC(PACK_RESISTANCE, fmt_resistance);
+MAX17055_REG_DESC(SYS_RESISTANCE, fmt_resistance);
+MAX17055_REG_DESC(AT_Q_RESIDUAL, fmt_capacity);
+MAX17055_REG_DESC(AT_TTE, fmt_time);
+MAX17055_REG_DESC(AT_AV_SOC, fmt_percent);
+MAX17055_REG_DESC(AT_AV_CA, fmt_capacity);
+
 #endif
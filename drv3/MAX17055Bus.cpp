@@ -0,0 +1,265 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#include "MAX17055Bus.h"
+
+//******************************************************************************
+MAX17055Bus::MAX17055Bus(I2C &i2c, int mux_address) :
+    mbed_transport(&i2c),
+    transport(mbed_transport),
+    mux_addr(mux_address),
+    select_fn(callback(this, &MAX17055Bus::muxWrite)),
+    custom_select(false),
+    num_gauges(0),
+    channel(MAX17055_BUS_NO_CHANNEL),
+    num_switches(0),
+    queued(0)
+{
+}
+
+//******************************************************************************
+MAX17055Bus::MAX17055Bus(MAX17055Transport &transport, int mux_address) :
+    transport(transport),
+    mux_addr(mux_address),
+    select_fn(callback(this, &MAX17055Bus::muxWrite)),
+    custom_select(false),
+    num_gauges(0),
+    channel(MAX17055_BUS_NO_CHANNEL),
+    num_switches(0),
+    queued(0)
+{
+}
+
+//******************************************************************************
+MAX17055Bus::~MAX17055Bus()
+{
+}
+
+//******************************************************************************
+void MAX17055Bus::set_select(Callback<int(int)> select)
+{
+    mutex.lock();
+    select_fn = select;
+    custom_select = true;
+    channel = MAX17055_BUS_NO_CHANNEL;
+    mutex.unlock();
+}
+
+//******************************************************************************
+int MAX17055Bus::attach(MAX17055 &gauge, int channel)
+{
+    int id;
+
+    mutex.lock();
+
+    // The default select shifts a bit per channel into an 8-bit mask
+    if ((num_gauges == MAX17055_BUS_MAX_GAUGES) || (channel < 0) ||
+        (!custom_select && (channel >= MAX17055_BUS_MUX_CHANNELS))) {
+        mutex.unlock();
+        return MAX17055_ERROR;
+    }
+
+    id = num_gauges++;
+    gauges[id].gauge = &gauge;
+    gauges[id].channel = channel;
+
+    mutex.unlock();
+
+    return id;
+}
+
+//******************************************************************************
+int MAX17055Bus::queue_read(int id, MAX17055::reg_t reg, uint16_t *value,
+                            int count, Callback<void(int)> done)
+{
+    request_t req;
+
+    req.op = OP_READ;
+    req.id = id;
+    req.reg = reg;
+    req.value = value;
+    req.count = count;
+    req.snap = NULL;
+    req.done = done;
+
+    return enqueue(req);
+}
+
+//******************************************************************************
+int MAX17055Bus::queue_snapshot(int id, MAX17055::snapshot_t *snap,
+                                Callback<void(int)> done)
+{
+    request_t req;
+
+    req.op = OP_SNAPSHOT;
+    req.id = id;
+    req.reg = MAX17055::STATUS;
+    req.value = NULL;
+    req.count = 0;
+    req.snap = snap;
+    req.done = done;
+
+    return enqueue(req);
+}
+
+//******************************************************************************
+int MAX17055Bus::enqueue(const request_t &req)
+{
+    mutex.lock();
+
+    if ((req.id < 0) || (req.id >= num_gauges) ||
+        (queued == MAX17055_BUS_QUEUE_DEPTH)) {
+        mutex.unlock();
+        return MAX17055_ERROR;
+    }
+
+    queue[queued++] = req;
+
+    mutex.unlock();
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055Bus::flush()
+{
+    request_t done[MAX17055_BUS_QUEUE_DEPTH];
+    int result[MAX17055_BUS_QUEUE_DEPTH];
+    int ret = MAX17055_NO_ERROR;
+    int num_done = 0;
+    int i, next;
+
+    mutex.lock();
+
+    while (queued) {
+        // Stay on the selected channel while it has work, in queue order
+        next = 0;
+        for (i = 0; i < queued; i++) {
+            if (gauges[queue[i].id].channel == channel) {
+                next = i;
+                break;
+            }
+        }
+
+        request_t &req = queue[next];
+        MAX17055 *gauge = gauges[req.id].gauge;
+        int r = select(gauges[req.id].channel);
+
+        if (!r) {
+            if (req.op == OP_SNAPSHOT) {
+                r = gauge->snapshot(req.snap);
+            } else {
+                r = gauge->readRegs(req.reg, req.value, req.count);
+            }
+        }
+
+        if (r) {
+            ret = MAX17055_ERROR;
+        }
+
+        done[num_done] = req;
+        result[num_done++] = r;
+
+        for (i = next + 1; i < queued; i++) {
+            queue[i - 1] = queue[i];
+        }
+        queued--;
+    }
+
+    mutex.unlock();
+
+    // Outside the lock, so that callbacks may queue more work
+    for (i = 0; i < num_done; i++) {
+        if (done[i].done) {
+            done[i].done(result[i]);
+        }
+    }
+
+    return ret;
+}
+
+//******************************************************************************
+int MAX17055Bus::acquire(int id)
+{
+    mutex.lock();
+
+    if ((id < 0) || (id >= num_gauges) || select(gauges[id].channel)) {
+        mutex.unlock();
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+void MAX17055Bus::release()
+{
+    mutex.unlock();
+}
+
+//******************************************************************************
+int MAX17055Bus::select(int channel)
+{
+    if (channel == this->channel) {
+        return MAX17055_NO_ERROR;
+    }
+
+    if (select_fn(channel)) {
+        // Unknown mux state, reselect next time
+        this->channel = MAX17055_BUS_NO_CHANNEL;
+        return MAX17055_ERROR;
+    }
+
+    this->channel = channel;
+    num_switches++;
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+int MAX17055Bus::muxWrite(int channel)
+{
+    char buf[1];
+
+    if ((channel < 0) || (channel >= MAX17055_BUS_MUX_CHANNELS)) {
+        return MAX17055_ERROR;
+    }
+
+    buf[0] = (char)(1 << channel);
+
+    if (transport.write(mux_addr, buf, sizeof(buf))) {
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#ifndef _MAX17055_BUS_H_
+#define _MAX17055_BUS_H_
+
+#include "mbed.h"
+#include "MAX17055.h"
+
+#define MAX17055_BUS_MUX_ADDRESS 0xE0   // TCA9548A-style mux, A[2:0] = 0
+#define MAX17055_BUS_MUX_CHANNELS 8     // Channels of the default mux
+#define MAX17055_BUS_NO_CHANNEL  -1
+
+#ifndef MAX17055_BUS_MAX_GAUGES
+#define MAX17055_BUS_MAX_GAUGES  8
+#endif
+
+#ifndef MAX17055_BUS_QUEUE_DEPTH
+#define MAX17055_BUS_QUEUE_DEPTH 16
+#endif
+
+/**
+ * @brief Shared I2C bus for several MAX17055 behind a mux
+ *
+ * @details All MAX17055 share the same slave address, so boards with several
+ * cells put each gauge behind a channel of an I2C mux. MAX17055Bus owns the
+ * mux selection and serializes access to the bus: reads from any thread are
+ * queued and executed by flush() grouped by mux channel, starting with the
+ * channel that is already selected, so that each channel is selected at most
+ * once per flush.
+ *
+ * The gauges must be constructed on the same I2C object or transport as the
+ * bus and must only be used through the bus, or between acquire() and
+ * release().
+ *
+ * @code
+ * I2C i2c(I2C2_SDA, I2C2_SCL);
+ * MAX17055Bus bus(i2c);
+ * MAX17055 cell0(i2c), cell1(i2c);
+ * MAX17055::snapshot_t snap0, snap1;
+ *
+ * int id0 = bus.attach(cell0, 0);
+ * int id1 = bus.attach(cell1, 1);
+ *
+ * bus.queue_snapshot(id0, &snap0);
+ * bus.queue_snapshot(id1, &snap1);
+ * bus.flush();
+ * @endcode
+ */
+class MAX17055Bus
+{
+public:
+
+    /**
+     * MAX17055Bus constructor
+     *
+     * @param i2c I2C object the gauges and the mux are on.
+     * @param mux_address Slave address of the mux.
+     */
+    MAX17055Bus(I2C &i2c, int mux_address = MAX17055_BUS_MUX_ADDRESS);
+
+    /**
+     * MAX17055Bus constructor
+     *
+     * @param transport Bus transport the gauges and the mux are on.
+     * @param mux_address Slave address of the mux.
+     */
+    MAX17055Bus(MAX17055Transport &transport,
+                int mux_address = MAX17055_BUS_MUX_ADDRESS);
+
+    /**
+     * MAX17055Bus destructor
+     */
+    ~MAX17055Bus();
+
+    /**
+     * @brief   Set the mux select function
+     * @details Replaces the default TCA9548A-style select, which writes
+     * the channel bit mask to the mux. The function is called with the
+     * bus locked and returns 0 on success. It must validate the channels
+     * itself, attach() then only rejects negative channels.
+     * @param   select The mux select function
+     */
+    void set_select(Callback<int(int)> select);
+
+    /**
+     * @brief   Register a gauge
+     * @details With the default select, channel must be
+     * 0..MAX17055_BUS_MUX_CHANNELS - 1.
+     * @param   gauge The gauge
+     * @param   channel The mux channel the gauge is on
+     * @returns Gauge id if no errors, -1 if error
+     */
+    int attach(MAX17055 &gauge, int channel);
+
+    /**
+     * @brief   Queue a register read
+     * @details Queues a burst read of count registers from gauge id. done,
+     * if set, is called from flush() with 0 or -1 once the read ran.
+     * value must stay valid until then.
+     * @param   id The gauge id
+     * @param   reg The first register to be read
+     * @param   value Pointer for where to store the data
+     * @param   count Number of registers to read
+     * @param   done Completion callback
+     * @returns 0 if queued, -1 if the queue is full or error
+     */
+    int queue_read(int id, MAX17055::reg_t reg, uint16_t *value, int count,
+                   Callback<void(int)> done = Callback<void(int)>());
+
+    /**
+     * @brief   Queue a snapshot
+     * @details Like queue_read(), for MAX17055::snapshot().
+     * @param   id The gauge id
+     * @param   snap The location to store the snapshot
+     * @param   done Completion callback
+     * @returns 0 if queued, -1 if the queue is full or error
+     */
+    int queue_snapshot(int id, MAX17055::snapshot_t *snap,
+                       Callback<void(int)> done = Callback<void(int)>());
+
+    /**
+     * @brief   Execute queued reads
+     * @details Runs every queued request, grouped by mux channel, then
+     * calls their completion callbacks.
+     * @returns 0 if all reads succeeded, -1 if any failed
+     */
+    int flush();
+
+    /**
+     * @brief   Lock the bus for a gauge
+     * @details Locks the bus and selects the channel of gauge id, so that
+     * any MAX17055 call can be made on it. Must be paired with release().
+     * @param   id The gauge id
+     * @returns 0 if no errors, -1 if error (the bus is not locked)
+     */
+    int acquire(int id);
+
+    /**
+     * @brief   Unlock the bus
+     */
+    void release();
+
+    /**
+     * @brief   Mux switches
+     * @returns Number of mux channel selections made
+     */
+    uint32_t switches() const { return num_switches; }
+
+private:
+    typedef enum {
+        OP_READ,
+        OP_SNAPSHOT
+    } op_t;
+
+    struct request_t {
+        op_t op;
+        int id;
+        MAX17055::reg_t reg;
+        uint16_t *value;
+        int count;
+        MAX17055::snapshot_t *snap;
+        Callback<void(int)> done;
+    };
+
+    struct gauge_t {
+        MAX17055 *gauge;
+        int channel;
+    };
+
+    int enqueue(const request_t &req);
+    int select(int channel);
+    int muxWrite(int channel);
+
+    MAX17055MbedTransport mbed_transport;
+    MAX17055Transport &transport;
+    int mux_addr;
+    Callback<int(int)> select_fn;
+    bool custom_select;
+    Mutex mutex;
+
+    gauge_t gauges[MAX17055_BUS_MAX_GAUGES];
+    int num_gauges;
+    int channel;
+    uint32_t num_switches;
+
+    request_t queue[MAX17055_BUS_QUEUE_DEPTH];
+    int queued;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#include "MAX17055LinuxTransport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+//******************************************************************************
+MAX17055LinuxTransport::MAX17055LinuxTransport() :
+    fd(-1)
+{
+}
+
+//******************************************************************************
+MAX17055LinuxTransport::~MAX17055LinuxTransport()
+{
+    close();
+}
+
+//******************************************************************************
+int MAX17055LinuxTransport::open(int bus)
+{
+    char path[32];
+
+    close();
+
+    snprintf(path, sizeof(path), "/dev/i2c-%d", bus);
+    fd = ::open(path, O_RDWR);
+
+    return (fd < 0) ? -1 : 0;
+}
+
+//******************************************************************************
+void MAX17055LinuxTransport::close()
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+//******************************************************************************
+int MAX17055LinuxTransport::writeRead(int addr, const char *tx, int tx_len,
+                                      char *rx, int rx_len)
+{
+    struct i2c_msg msgs[2];
+    struct i2c_rdwr_ioctl_data xfer;
+
+    msgs[0].addr = addr >> 1;
+    msgs[0].flags = 0;
+    msgs[0].len = tx_len;
+    msgs[0].buf = (__u8 *)tx;
+
+    msgs[1].addr = addr >> 1;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = rx_len;
+    msgs[1].buf = (__u8 *)rx;
+
+    xfer.msgs = msgs;
+    xfer.nmsgs = (rx_len > 0) ? 2 : 1;
+
+    if (ioctl(fd, I2C_RDWR, &xfer) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+//******************************************************************************
+void MAX17055LinuxTransport::delay_ms(int ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+
+    while (nanosleep(&ts, &ts) && (errno == EINTR)) {
+    }
+}
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#ifndef _MAX17055_LINUX_TRANSPORT_H_
+#define _MAX17055_LINUX_TRANSPORT_H_
+
+#include "MAX17055Transport.h"
+
+/**
+ * @brief Linux i2c-dev transport
+ *
+ * @details Talks to /dev/i2c-N. writeRead() is a single I2C_RDWR ioctl with
+ * a write and a read message, so the read uses a repeated start. The 8-bit
+ * driver addresses are converted to the 7-bit addresses i2c-dev expects.
+ *
+ * @code
+ * MAX17055LinuxTransport transport;
+ * MAX17055 max17055(transport);
+ *
+ * if (transport.open(1) == 0) {
+ *     max17055.init(0.01f);
+ * }
+ * @endcode
+ */
+class MAX17055LinuxTransport : public MAX17055Transport
+{
+public:
+    MAX17055LinuxTransport();
+    virtual ~MAX17055LinuxTransport();
+
+    /**
+     * @brief   Open an adapter
+     * @param   bus Adapter number N of /dev/i2c-N
+     * @returns 0 if no errors, -1 if error
+     */
+    int open(int bus);
+
+    /**
+     * @brief   Close the adapter
+     */
+    void close();
+
+    virtual int writeRead(int addr, const char *tx, int tx_len,
+                          char *rx, int rx_len);
+    virtual void delay_ms(int ms);
+
+private:
+    int fd;
+};
+
+#endif
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#include "MAX17055Sampler.h"
+
+#if (MAX17055_SAMPLER_DEPTH & (MAX17055_SAMPLER_DEPTH - 1)) != 0
+#error "MAX17055_SAMPLER_DEPTH must be a power of two"
+#endif
+
+//******************************************************************************
+MAX17055Sampler::MAX17055Sampler(MAX17055 &gauge, osPriority priority) :
+    gauge(gauge),
+    thread(priority),
+    period_ms(0),
+    running(false),
+    head(0),
+    tail(0),
+    dropped(0),
+    failed(0)
+{
+}
+
+//******************************************************************************
+MAX17055Sampler::~MAX17055Sampler()
+{
+    stop();
+}
+
+//******************************************************************************
+int MAX17055Sampler::start(uint32_t period_ms)
+{
+    // Deadlines are tracked in signed microseconds
+    if (running || (period_ms == 0) || (period_ms > INT32_MAX / 1000)) {
+        return MAX17055_ERROR;
+    }
+
+    this->period_ms = period_ms;
+    running = true;
+
+    if (thread.start(callback(this, &MAX17055Sampler::run)) != osOK) {
+        running = false;
+        return MAX17055_ERROR;
+    }
+
+    return MAX17055_NO_ERROR;
+}
+
+//******************************************************************************
+void MAX17055Sampler::stop()
+{
+    if (running) {
+        running = false;
+        thread.join();
+    }
+}
+
+//******************************************************************************
+void MAX17055Sampler::run()
+{
+    MAX17055::snapshot_t snap;
+    sample_t sample;
+    uint32_t next_us = us_ticker_read();
+    int32_t left_us;
+    int value;
+
+    while (running) {
+        sample.timestamp_us = us_ticker_read();
+
+        if (gauge.snapshot(&snap) ||
+            snap.v_cell_uv(&sample.v_cell_uv) ||
+            snap.avg_v_cell_uv(&sample.avg_v_cell_uv) ||
+            snap.current_ua(&sample.current_ua) ||
+            snap.avg_current_ua(&sample.avg_current_ua) ||
+            snap.temp_mc(&sample.temp_mc) ||
+            snap.reg(MAX17055::REP_SOC, &value)) {
+            failed++;
+        } else {
+            sample.rep_soc = value;
+            snap.status(&value);
+            sample.status = value;
+
+            if (!push(sample)) {
+                dropped++;
+            }
+        }
+
+        // Sleep until the next deadline, so the read time does not add up
+        next_us += period_ms * 1000;
+        left_us = (int32_t)(next_us - us_ticker_read());
+        if (left_us > 0) {
+            Thread::wait((left_us + 999) / 1000);
+        } else {
+            // Overran a whole period, restart from now instead of bursting
+            next_us = us_ticker_read();
+        }
+    }
+}
+
+//******************************************************************************
+bool MAX17055Sampler::push(const sample_t &sample)
+{
+    uint32_t h = head;
+
+    if ((h - tail) == MAX17055_SAMPLER_DEPTH) {
+        return false;
+    }
+
+    ring[h & (MAX17055_SAMPLER_DEPTH - 1)] = sample;
+
+    // Publish the sample before the index that makes it visible
+    __DMB();
+    head = h + 1;
+
+    return true;
+}
+
+//******************************************************************************
+bool MAX17055Sampler::pop(sample_t *sample)
+{
+    uint32_t t = tail;
+
+    if (head == t) {
+        return false;
+    }
+
+    // Read the sample only after seeing the index that published it
+    __DMB();
+    *sample = ring[t & (MAX17055_SAMPLER_DEPTH - 1)];
+
+    // Done with the slot before handing it back to the producer
+    __DMB();
+    tail = t + 1;
+
+    return true;
+}
+
+//******************************************************************************
+uint32_t MAX17055Sampler::available() const
+{
+    return head - tail;
+}
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#ifndef _MAX17055_SAMPLER_H_
+#define _MAX17055_SAMPLER_H_
+
+#include "mbed.h"
+#include "MAX17055.h"
+
+#ifndef MAX17055_SAMPLER_DEPTH
+#define MAX17055_SAMPLER_DEPTH 16   // must be a power of two
+#endif
+
+/**
+ * @brief MAX17055 background sampler
+ *
+ * @details Reads a MAX17055 snapshot at a fixed period on its own thread and
+ * queues decoded, timestamped samples in a lock-free single-producer,
+ * single-consumer ring. One consumer thread pops samples without locking or
+ * touching the bus. When the consumer falls behind, new samples are dropped
+ * and counted rather than overwriting unread ones.
+ *
+ * The sampler thread is the only user of the MAX17055 object while it runs;
+ * the integer API must have been set up with init() or init_uohm().
+ *
+ * @code
+ * MAX17055 max17055(i2c);
+ * MAX17055Sampler sampler(max17055);
+ *
+ * max17055.init(0.01f);
+ * sampler.start(100);
+ *
+ * for (;;) {
+ *     MAX17055Sampler::sample_t s;
+ *
+ *     while (sampler.pop(&s)) {
+ *         printf("%lu %ld uV %ld uA\r\n", s.timestamp_us, s.v_cell_uv,
+ *                s.current_ua);
+ *     }
+ *     Thread::wait(500);
+ * }
+ * @endcode
+ */
+class MAX17055Sampler
+{
+public:
+
+    /**
+     * @brief   Sample
+     * @details One decoded snapshot
+     */
+    struct sample_t {
+        uint32_t timestamp_us;  // us_ticker_read() when the read started
+        int32_t v_cell_uv;
+        int32_t avg_v_cell_uv;
+        int32_t current_ua;
+        int32_t avg_current_ua;
+        int32_t temp_mc;
+        uint16_t rep_soc;       // 1/256 %
+        uint16_t status;
+    };
+
+    /**
+     * MAX17055Sampler constructor
+     *
+     * @param gauge The MAX17055 object to sample.
+     * @param priority Priority of the sampler thread.
+     */
+    MAX17055Sampler(MAX17055 &gauge, osPriority priority = osPriorityNormal);
+
+    /**
+     * MAX17055Sampler destructor
+     */
+    ~MAX17055Sampler();
+
+    /**
+     * @brief   Start sampling
+     * @details Starts the sampler thread. A sampler can only be started
+     * once. Reads start on a fixed grid of period_ms, independent of how
+     * long each read takes.
+     * @param   period_ms Sampling period in milliseconds, at most
+     * INT32_MAX / 1000
+     * @returns 0 if no errors, -1 if error
+     */
+    int start(uint32_t period_ms);
+
+    /**
+     * @brief   Stop sampling
+     * @details Stops the sampler thread and waits for it to exit.
+     */
+    void stop();
+
+    /**
+     * @brief   Pop the oldest sample
+     * @details Consumer side of the ring, call from one thread only.
+     * @param   sample The location to store the sample
+     * @returns true if a sample was popped, false if the ring was empty
+     */
+    bool pop(sample_t *sample);
+
+    /**
+     * @brief   Number of queued samples
+     * @returns Samples ready to pop
+     */
+    uint32_t available() const;
+
+    /**
+     * @brief   Dropped samples
+     * @details Samples dropped because the ring was full
+     * @returns Number of dropped samples
+     */
+    uint32_t overruns() const { return dropped; }
+
+    /**
+     * @brief   Failed reads
+     * @returns Number of snapshots that could not be read
+     */
+    uint32_t errors() const { return failed; }
+
+private:
+    void run();
+    bool push(const sample_t &sample);
+
+    MAX17055 &gauge;
+    Thread thread;
+    uint32_t period_ms;
+    volatile bool running;
+
+    sample_t ring[MAX17055_SAMPLER_DEPTH];
+    volatile uint32_t head;     // written by the producer only
+    volatile uint32_t tail;     // written by the consumer only
+    volatile uint32_t dropped;
+    volatile uint32_t failed;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#include "MAX17055SimTransport.h"
+
+#include <string.h>
+
+//******************************************************************************
+MAX17055SimTransport::MAX17055SimTransport(int address) :
+    transactions(0),
+    elapsed_ms(0),
+    addr(address)
+{
+    memset(regs, 0, sizeof(regs));
+    memset(self_clear, 0, sizeof(self_clear));
+}
+
+//******************************************************************************
+int MAX17055SimTransport::writeRead(int addr, const char *tx, int tx_len,
+                                    char *rx, int rx_len)
+{
+    uint8_t reg;
+    int i;
+
+    transactions++;
+
+    // No device at that address, or nothing to address a register with
+    if ((addr != this->addr) || (tx_len < 1)) {
+        return -1;
+    }
+
+    reg = tx[0];
+
+    for (i = 1; i + 1 < tx_len; i += 2, reg++) {
+        regs[reg] = (uint16_t)((uint8_t)tx[i] | ((uint8_t)tx[i + 1] << 8));
+        regs[reg] &= ~self_clear[reg];
+    }
+
+    // A trailing odd byte only replaces the low byte of its register
+    if (i < tx_len) {
+        regs[reg] = (uint16_t)((regs[reg] & 0xFF00) | (uint8_t)tx[i]);
+        regs[reg] &= ~self_clear[reg];
+    }
+
+    reg = tx[0];
+
+    for (i = 0; i < rx_len; i++) {
+        rx[i] = (i & 1) ? (char)(regs[reg] >> 8) : (char)regs[reg];
+        if (i & 1) {
+            reg++;
+        }
+    }
+
+    return 0;
+}
+
+//******************************************************************************
+void MAX17055SimTransport::delay_ms(int ms)
+{
+    elapsed_ms += ms;
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#ifndef _MAX17055_SIM_TRANSPORT_H_
+#define _MAX17055_SIM_TRANSPORT_H_
+
+#include <stdint.h>
+#include "MAX17055Transport.h"
+
+/**
+ * @brief In-process MAX17055 register simulator
+ *
+ * @details Serves the driver from a 256-entry register file with the
+ * device's little-endian, auto-incrementing access, for host-side tests
+ * and benchmarks. Bits in self_clear are cleared right after a write, which
+ * models completion of e.g. ModelCfg.Refresh. A write ending in an odd
+ * byte updates only the low byte of the last register. Delays only
+ * advance elapsed_ms.
+ *
+ * @code
+ * MAX17055SimTransport sim;
+ * MAX17055 max17055(sim);
+ * int v;
+ *
+ * sim.regs[MAX17055::V_CELL] = 0xD000;
+ * max17055.v_cell(&v);
+ * @endcode
+ */
+class MAX17055SimTransport : public MAX17055Transport
+{
+public:
+    /**
+     * MAX17055SimTransport constructor
+     *
+     * @param address Slave address the simulated device answers to.
+     */
+    MAX17055SimTransport(int address = 0x6C);
+
+    virtual int writeRead(int addr, const char *tx, int tx_len,
+                          char *rx, int rx_len);
+    virtual void delay_ms(int ms);
+
+    uint16_t regs[256];
+    uint16_t self_clear[256];
+    uint32_t transactions;
+    uint32_t elapsed_ms;
+
+private:
+    int addr;
+};
+
+#endif
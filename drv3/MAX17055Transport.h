@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+#ifndef _MAX17055_TRANSPORT_H_
+#define _MAX17055_TRANSPORT_H_
+
+#ifdef __MBED__
+#include "mbed.h"
+#else
+#include <stddef.h>
+#endif
+
+/**
+ * @brief MAX17055 bus transport
+ *
+ * @details The operations the MAX17055 driver needs from the bus. Slave
+ * addresses are 8-bit, as with mbed I2C. Each backend implements them with
+ * the fastest primitive it has; writeRead() in particular must address and
+ * read the device in one transaction with a repeated start.
+ */
+class MAX17055Transport
+{
+public:
+    virtual ~MAX17055Transport() {}
+
+    /**
+     * @brief   Combined write and read
+     * @details Writes tx, then with a repeated start reads rx_len bytes.
+     * With rx_len 0 this is a plain write.
+     * @param   addr Slave address
+     * @param   tx Data to write
+     * @param   tx_len Number of bytes to write
+     * @param   rx Where to store the data read
+     * @param   rx_len Number of bytes to read
+     * @returns 0 if no errors, -1 if error
+     */
+    virtual int writeRead(int addr, const char *tx, int tx_len,
+                          char *rx, int rx_len) = 0;
+
+    /**
+     * @brief   Burst write
+     * @param   addr Slave address
+     * @param   buf Data to write
+     * @param   len Number of bytes to write
+     * @returns 0 if no errors, -1 if error
+     */
+    virtual int write(int addr, const char *buf, int len)
+    {
+        return writeRead(addr, buf, len, NULL, 0);
+    }
+
+    /**
+     * @brief   Delay
+     * @param   ms Milliseconds to wait
+     */
+    virtual void delay_ms(int ms) = 0;
+
+#if DEVICE_I2C_ASYNCH
+    /**
+     * @brief   Asynchronous combined write and read
+     * @details Starts the same transaction as writeRead() and returns.
+     * event is called from interrupt context with the I2C_EVENT_* flags
+     * once it completes. tx and rx must stay valid until then. Backends
+     * without an asynchronous primitive keep this default, which fails.
+     * @param   addr Slave address
+     * @param   tx Data to write
+     * @param   tx_len Number of bytes to write
+     * @param   rx Where to store the data read
+     * @param   rx_len Number of bytes to read
+     * @param   event Completion callback
+     * @returns 0 if started, -1 if error or not supported
+     */
+    virtual int writeReadAsync(int addr, const char *tx, int tx_len,
+                               char *rx, int rx_len,
+                               const event_callback_t &event)
+    {
+        return -1;
+    }
+#endif
+};
+
+#ifdef __MBED__
+/**
+ * @brief mbed I2C transport
+ */
+class MAX17055MbedTransport : public MAX17055Transport
+{
+public:
+    MAX17055MbedTransport(I2C *i2c = NULL) : i2c(i2c) {}
+
+    virtual int writeRead(int addr, const char *tx, int tx_len,
+                          char *rx, int rx_len)
+    {
+        if (i2c->write(addr, tx, tx_len, rx_len > 0)) {
+            return -1;
+        }
+
+        if ((rx_len > 0) && i2c->read(addr, rx, rx_len)) {
+            return -1;
+        }
+
+        return 0;
+    }
+
+    virtual int write(int addr, const char *buf, int len)
+    {
+        return i2c->write(addr, buf, len) ? -1 : 0;
+    }
+
+    virtual void delay_ms(int ms)
+    {
+        Thread::wait(ms);
+    }
+
+#if DEVICE_I2C_ASYNCH
+    virtual int writeReadAsync(int addr, const char *tx, int tx_len,
+                               char *rx, int rx_len,
+                               const event_callback_t &event)
+    {
+        return i2c->transfer(addr, tx, tx_len, rx, rx_len, event,
+                             I2C_EVENT_ALL) ? -1 : 0;
+    }
+#endif
+
+    I2C *i2c;
+};
+#endif
+
+#endif
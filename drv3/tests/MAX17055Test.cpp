@@ -0,0 +1,399 @@
+/*******************************************************************************
+ * Copyright (C) 2018 Maxim Integrated Products, Inc., All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the name of Maxim Integrated
+ * Products, Inc. shall not be used except as stated in the Maxim Integrated
+ * Products, Inc. Branding Policy.
+ *
+ * The mere transfer of this software does not imply any licenses
+ * of trade secrets, proprietary technology, copyrights, patents,
+ * trademarks, maskwork rights, or any other form of intellectual
+ * property whatsoever. Maxim Integrated Products, Inc. retains all
+ * ownership rights.
+ *******************************************************************************
+ */
+
+// Host-side tests for the MAX17055 driver, run against
+// MAX17055SimTransport. Build and run with "make check".
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "MAX17055.h"
+#include "MAX17055SimTransport.h"
+
+static int failures;
+
+#define CHECK_EQ(actual, expected)                                          \
+    do {                                                                    \
+        long _a = (long)(actual);                                           \
+        long _e = (long)(expected);                                         \
+        if (_a != _e) {                                                     \
+            printf("%s:%d: %s == 0x%lX, expected 0x%lX\n",                  \
+                   __FILE__, __LINE__, #actual, _a, _e);                    \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+//******************************************************************************
+static void test_sim_odd_write()
+{
+    MAX17055SimTransport sim;
+    const char one[] = { MAX17055::CONFIG, 0x34 };
+    const char three[] = { MAX17055::CONFIG, 0x78, 0x56, 0x1A };
+
+    sim.regs[MAX17055::CONFIG] = 0x1200;
+    sim.regs[MAX17055::CONFIG + 1] = 0xBC00;
+
+    CHECK_EQ(sim.writeRead(0x6C, one, sizeof(one), NULL, 0), 0);
+    CHECK_EQ(sim.regs[MAX17055::CONFIG], 0x1234);
+
+    CHECK_EQ(sim.writeRead(0x6C, three, sizeof(three), NULL, 0), 0);
+    CHECK_EQ(sim.regs[MAX17055::CONFIG], 0x5678);
+    CHECK_EQ(sim.regs[MAX17055::CONFIG + 1], 0xBC1A);
+}
+
+//******************************************************************************
+static void test_i_alrt_th_ma()
+{
+    MAX17055SimTransport sim;
+    MAX17055 max17055(sim);
+
+    max17055.init(0.01f);
+
+    // 0.4 mV / 10 mOhm = 40 mA per LSB
+    CHECK_EQ(max17055.set_i_alrt_th(1000.0f, -1000.0f), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.regs[MAX17055::I_ALRT_TH], 0x19E7);
+
+    CHECK_EQ(max17055.set_i_alrt_th(20.0f, -20.0f), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.regs[MAX17055::I_ALRT_TH], 0x01FF);
+
+    // Out of range thresholds saturate
+    CHECK_EQ(max17055.set_i_alrt_th(10000.0f, -10000.0f), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.regs[MAX17055::I_ALRT_TH], 0x7F80);
+}
+
+//******************************************************************************
+static bool near(const char *name, int raw, int32_t actual, double expected,
+                 double tolerance)
+{
+    if (fabs(actual - expected) <= tolerance) {
+        return true;
+    }
+
+    printf("%s: raw 0x%04X gives %ld, float API gives %f\n",
+           name, raw, (long)actual, expected);
+    failures++;
+    return false;
+}
+
+//******************************************************************************
+static void test_integer_matches_float()
+{
+    MAX17055SimTransport sim;
+    MAX17055 max17055(sim);
+    int32_t uv, ua, avg_ua, mc, max, min;
+    float v, i, avg_i, t, f_max, f_min;
+    bool ok = true;
+    int raw;
+
+    max17055.init(0.01f);
+
+    // Float APIs return V, mA, A (MaxMinCurr) and degrees C. The integer
+    // voltage and temperature conversions truncate, so they may be up to
+    // one uV or m°C low, plus float rounding near full scale.
+    for (raw = 0; ok && (raw <= 0xFFFF); raw++) {
+        sim.regs[MAX17055::V_CELL] = raw;
+        sim.regs[MAX17055::CURRENT] = raw;
+        sim.regs[MAX17055::AVG_CURRENT] = raw;
+        sim.regs[MAX17055::TEMP] = raw;
+        sim.regs[MAX17055::MAX_MIN_CURR] = raw;
+        sim.regs[MAX17055::MAX_MIN_VOLT] = raw;
+
+        CHECK_EQ(max17055.v_cell_uv(&uv), MAX17055_NO_ERROR);
+        CHECK_EQ(max17055.v_cell(&v), MAX17055_NO_ERROR);
+        ok &= near("v_cell_uv", raw, uv, v * 1e6, 1.5);
+
+        CHECK_EQ(max17055.current_ua(&ua), MAX17055_NO_ERROR);
+        CHECK_EQ(max17055.current(&i), MAX17055_NO_ERROR);
+        ok &= near("current_ua", raw, ua, i * 1e3, 0.5);
+
+        CHECK_EQ(max17055.avg_current_ua(&avg_ua), MAX17055_NO_ERROR);
+        CHECK_EQ(max17055.avg_current(&avg_i), MAX17055_NO_ERROR);
+        ok &= near("avg_current_ua", raw, avg_ua, avg_i * 1e3, 0.5);
+
+        CHECK_EQ(max17055.temp_mc(&mc), MAX17055_NO_ERROR);
+        CHECK_EQ(max17055.temp(&t), MAX17055_NO_ERROR);
+        ok &= near("temp_mc", raw, mc, t * 1e3, 1.0);
+
+        CHECK_EQ(max17055.max_min_curr_ua(&max, &min), MAX17055_NO_ERROR);
+        CHECK_EQ(max17055.max_min_curr(&f_max, &f_min), MAX17055_NO_ERROR);
+        ok &= near("max_min_curr_ua max", raw, max, f_max * 1e6, 0.5);
+        ok &= near("max_min_curr_ua min", raw, min, f_min * 1e6, 0.5);
+
+        CHECK_EQ(max17055.max_min_volt_uv(&max, &min), MAX17055_NO_ERROR);
+        CHECK_EQ(max17055.max_min_volt(&f_max, &f_min), MAX17055_NO_ERROR);
+        ok &= near("max_min_volt_uv max", raw, max, f_max * 1e6, 0.5);
+        ok &= near("max_min_volt_uv min", raw, min, f_min * 1e6, 0.5);
+    }
+}
+
+//******************************************************************************
+static void test_init_zero_design_cap()
+{
+    MAX17055SimTransport sim;
+    MAX17055 max17055(sim);
+    MAX17055::ez_config_t cfg = MAX17055::ez_config_t();
+
+    sim.regs[MAX17055::STATUS] = MAX17055_STATUS_POR;
+    sim.regs[MAX17055::HIB_CFG] = 0x870C;
+
+    CHECK_EQ(max17055.init(0.01f, cfg), MAX17055_ERROR);
+    // Rejected before any bus traffic, POR is left for a later init
+    CHECK_EQ(sim.transactions, 0);
+    CHECK_EQ(sim.regs[MAX17055::STATUS], MAX17055_STATUS_POR);
+    CHECK_EQ(sim.regs[MAX17055::HIB_CFG], 0x870C);
+}
+
+//******************************************************************************
+static void test_init_uohm_zero()
+{
+    MAX17055SimTransport sim;
+    MAX17055 max17055(sim);
+    MAX17055::ez_config_t cfg = MAX17055::ez_config_t();
+
+    cfg.design_cap = 0x1000;
+    sim.regs[MAX17055::STATUS] = MAX17055_STATUS_POR;
+
+    CHECK_EQ(max17055.init_uohm(0), MAX17055_ERROR);
+    CHECK_EQ(max17055.init_uohm(0, cfg), MAX17055_ERROR);
+    CHECK_EQ(sim.transactions, 0);
+    CHECK_EQ(max17055.init_uohm(10000), MAX17055_NO_ERROR);
+}
+
+//******************************************************************************
+// Adds the model table lock, under which MODEL_DATA reads back as zeros,
+// clears FStat.DNR after dnr_reads reads of F_STAT and can lose the first
+// drop_writes writes to drop_reg
+class GaugeSim : public MAX17055SimTransport
+{
+public:
+    GaugeSim() : dnr_reads(0), drop_reg(-1), drop_writes(0),
+                 drop_reg_writes(0) {}
+
+    virtual int writeRead(int addr, const char *tx, int tx_len,
+                          char *rx, int rx_len)
+    {
+        int reg, i, ret;
+
+        if ((tx_len > 1) && ((uint8_t)tx[0] == drop_reg)) {
+            drop_reg_writes++;
+            if (drop_writes > 0) {
+                drop_writes--;
+                transactions++;
+                return 0;
+            }
+        }
+
+        if ((rx_len > 0) && ((uint8_t)tx[0] == MAX17055::F_STAT) &&
+            (dnr_reads > 0) && !--dnr_reads) {
+            regs[MAX17055::F_STAT] &= ~MAX17055_FSTAT_DNR;
+        }
+
+        ret = MAX17055SimTransport::writeRead(addr, tx, tx_len, rx, rx_len);
+
+        if (!ret && (rx_len > 0) &&
+            ((regs[MAX17055::MODEL_LOCK1] != MAX17055_MODEL_UNLOCK1) ||
+             (regs[MAX17055::MODEL_LOCK2] != MAX17055_MODEL_UNLOCK2))) {
+            for (i = 0; i < rx_len; i++) {
+                reg = (uint8_t)tx[0] + i / 2;
+                if ((reg >= MAX17055::MODEL_DATA) &&
+                    (reg < MAX17055::MODEL_DATA + MAX17055_MODEL_WORDS)) {
+                    rx[i] = 0;
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    int dnr_reads;
+    int drop_reg;
+    int drop_writes;
+    int drop_reg_writes;
+};
+
+// Bus transactions of an EZ init from POR, with DNR set for one poll
+static const uint32_t TRANSACTIONS_EZ = 18;
+// The same with a custom model
+static const uint32_t TRANSACTIONS_MODEL = 33;
+
+//******************************************************************************
+static void sim_por(GaugeSim *sim)
+{
+    sim->regs[MAX17055::STATUS] = MAX17055_STATUS_POR;
+    sim->regs[MAX17055::F_STAT] = MAX17055_FSTAT_DNR;
+    sim->regs[MAX17055::HIB_CFG] = 0x870C;
+    sim->self_clear[MAX17055::MODEL_CFG] = MAX17055_MODELCFG_REFRESH;
+    sim->dnr_reads = 2;
+}
+
+//******************************************************************************
+static void test_init_ez_por()
+{
+    GaugeSim sim;
+    MAX17055 max17055(sim);
+    MAX17055::ez_config_t cfg = MAX17055::ez_config_t();
+    uint32_t transactions;
+
+    cfg.design_cap = 0x1000;
+    cfg.i_chg_term = 0x0640;
+    cfg.v_empty = 0xA561;
+    sim_por(&sim);
+
+    // Startup measurements that never complete time out, leaving POR
+    sim.dnr_reads = MAX17055_POLL_TRIES + 1;
+    CHECK_EQ(max17055.init(0.01f, cfg), MAX17055_ERROR);
+    CHECK_EQ(sim.elapsed_ms, MAX17055_POLL_TRIES * MAX17055_POLL_MS);
+    CHECK_EQ(sim.regs[MAX17055::STATUS], MAX17055_STATUS_POR);
+    CHECK_EQ(sim.regs[MAX17055::HIB_CFG], 0x870C);
+
+    sim_por(&sim);
+    sim.transactions = 0;
+    sim.elapsed_ms = 0;
+
+    CHECK_EQ(max17055.init(0.01f, cfg), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.regs[MAX17055::DESIGN_CAP], 0x1000);
+    CHECK_EQ(sim.regs[MAX17055::DQ_ACC], 0x1000 / 32);
+    CHECK_EQ(sim.regs[MAX17055::DP_ACC], 0x1000 / 32 * 44138 / 0x1000);
+    CHECK_EQ(sim.regs[MAX17055::I_CHG_TERM], 0x0640);
+    CHECK_EQ(sim.regs[MAX17055::V_EMPTY], 0xA561);
+    CHECK_EQ(sim.regs[MAX17055::MODEL_CFG], 0);
+    CHECK_EQ(sim.regs[MAX17055::HIB_CFG], 0x870C);
+    CHECK_EQ(sim.regs[MAX17055::STATUS], 0);
+    CHECK_EQ(sim.transactions, TRANSACTIONS_EZ);
+    CHECK_EQ(sim.elapsed_ms, MAX17055_POLL_MS);
+
+    // Without POR there is nothing to do
+    transactions = sim.transactions;
+    CHECK_EQ(max17055.init(0.01f, cfg), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.transactions, transactions + 1);
+}
+
+//******************************************************************************
+static void test_init_model_por()
+{
+    GaugeSim sim;
+    MAX17055 max17055(sim);
+    MAX17055::ez_config_t cfg = MAX17055::ez_config_t();
+    MAX17055::custom_model_t model;
+    int i;
+
+    for (i = 0; i < MAX17055_MODEL_WORDS; i++) {
+        model.data[i] = (uint16_t)(0x1000 + i);
+    }
+    model.r_comp0 = 0x0070;
+    model.temp_co = 0x223E;
+    model.qr_table[0] = 0x1050;
+    model.qr_table[1] = 0x2012;
+    model.qr_table[2] = 0x0B04;
+    model.qr_table[3] = 0x0885;
+    model.model_cfg = MAX17055_MODELCFG_VCHG;
+
+    cfg.design_cap = 0x1000;
+    cfg.i_chg_term = 0x0640;
+    cfg.v_empty = 0xA561;
+    cfg.high_charge_voltage = true;
+    sim_por(&sim);
+
+    CHECK_EQ(max17055.init(0.01f, cfg, &model), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.regs[MAX17055::DESIGN_CAP], 0x1000);
+    CHECK_EQ(sim.regs[MAX17055::DQ_ACC], 0x1000 / 32);
+    CHECK_EQ(sim.regs[MAX17055::DP_ACC], 0x1000 / 32 * 51200 / 0x1000);
+    CHECK_EQ(sim.regs[MAX17055::I_CHG_TERM], 0x0640);
+    CHECK_EQ(sim.regs[MAX17055::V_EMPTY], 0xA561);
+    CHECK_EQ(sim.regs[MAX17055::MODEL_CFG], MAX17055_MODELCFG_VCHG);
+    CHECK_EQ(sim.regs[MAX17055::HIB_CFG], 0x870C);
+    CHECK_EQ(sim.regs[MAX17055::STATUS], 0);
+    CHECK_EQ(memcmp(&sim.regs[MAX17055::MODEL_DATA], model.data,
+                    sizeof(model.data)), 0);
+    CHECK_EQ(sim.regs[MAX17055::MODEL_LOCK1], 0);
+    CHECK_EQ(sim.regs[MAX17055::MODEL_LOCK2], 0);
+    CHECK_EQ(sim.regs[MAX17055::R_COMP0], 0x0070);
+    CHECK_EQ(sim.regs[MAX17055::TEMP_CO], 0x223E);
+    CHECK_EQ(sim.regs[MAX17055::QR_TABLE_00], 0x1050);
+    CHECK_EQ(sim.regs[MAX17055::QR_TABLE_10], 0x2012);
+    CHECK_EQ(sim.regs[MAX17055::QR_TABLE_20], 0x0B04);
+    CHECK_EQ(sim.regs[MAX17055::QR_TABLE_30], 0x0885);
+    CHECK_EQ(sim.transactions, TRANSACTIONS_MODEL);
+}
+
+//******************************************************************************
+static void test_init_rewrite()
+{
+    GaugeSim sim;
+    MAX17055 max17055(sim);
+    MAX17055::ez_config_t cfg = MAX17055::ez_config_t();
+
+    cfg.design_cap = 0x1000;
+    sim_por(&sim);
+
+    // A lost write is caught by the read-back and written again
+    sim.drop_reg = MAX17055::DP_ACC;
+    sim.drop_writes = 1;
+
+    CHECK_EQ(max17055.init(0.01f, cfg), MAX17055_NO_ERROR);
+    CHECK_EQ(sim.regs[MAX17055::DP_ACC], 0x1000 / 32 * 44138 / 0x1000);
+    CHECK_EQ(sim.drop_reg_writes, 2);
+    CHECK_EQ(sim.regs[MAX17055::STATUS], 0);
+    CHECK_EQ(sim.transactions, TRANSACTIONS_EZ + 2);
+
+    // One that never sticks fails init and leaves POR set
+    sim_por(&sim);
+    sim.regs[MAX17055::DP_ACC] = 0;
+    sim.drop_writes = 100;
+    sim.drop_reg_writes = 0;
+
+    CHECK_EQ(max17055.init(0.01f, cfg), MAX17055_ERROR);
+    CHECK_EQ(sim.drop_reg_writes, 4);
+    CHECK_EQ(sim.regs[MAX17055::STATUS], MAX17055_STATUS_POR);
+}
+
+//******************************************************************************
+int main()
+{
+    test_sim_odd_write();
+    test_i_alrt_th_ma();
+    test_integer_matches_float();
+    test_init_zero_design_cap();
+    test_init_uohm_zero();
+    test_init_ez_por();
+    test_init_model_por();
+    test_init_rewrite();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+
+    printf("all tests passed\n");
+    return 0;
+}